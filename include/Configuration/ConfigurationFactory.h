@@ -17,8 +17,11 @@
 #ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATIONFACTORY_H_
 #define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATIONFACTORY_H_
 
+#include <chrono>
 #include <string>
 #include <memory>
+#include <memory_resource>
+#include <vector>
 #include "Configuration/ConfigurationInterface.h"
 
 namespace o2
@@ -38,6 +41,22 @@ class ConfigurationFactory
     /// \param uri The URI
     /// \return A unique_ptr containing a pointer to an interface to the requested back-end
     static std::unique_ptr<ConfigurationInterface> getConfiguration(const std::string& uri);
+
+    /// Get a ConfigurationInterface suitable for the given URI, allocating loaded values from the given resource
+    /// File backends keep each loaded tree in a monotonic arena drawing from the resource, remote backends ignore it.
+    /// \param uri The URI
+    /// \param resource Upstream memory resource, it must outlive the returned object
+    /// \return A unique_ptr containing a pointer to an interface to the requested back-end
+    static std::unique_ptr<ConfigurationInterface> getConfiguration(const std::string& uri,
+      std::pmr::memory_resource* resource);
+
+    /// Get a ConfigurationInterface suitable for the given URI, with the listed paths already fetched
+    /// \param uri The URI
+    /// \param prefetch Keys and prefixes fetched concurrently before returning
+    /// \param timeout Maximum time spent prefetching, see ConfigurationInterface::prefetch
+    /// \return A unique_ptr containing a pointer to an interface to the requested back-end
+    static std::unique_ptr<ConfigurationInterface> getConfiguration(const std::string& uri,
+      const std::vector<std::string>& prefetch, std::chrono::milliseconds timeout);
 };
 
 } // Configuration
@@ -18,8 +18,14 @@
 #ifndef O2_CONFIGURATION_CONFIGURATIONINTERFACE_H_
 #define O2_CONFIGURATION_CONFIGURATIONINTERFACE_H_
 
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 #include <boost/optional.hpp>
 #include <boost/property_tree/ptree.hpp>
 
@@ -30,6 +36,35 @@ namespace configuration
 
 using KeyValueMap = std::unordered_map<std::string, std::string>;
 
+/// Bytes of memory held by a backend
+struct MemoryUsage {
+  /// Key strings
+  std::size_t keys = 0;
+
+  /// Value strings
+  std::size_t values = 0;
+
+  /// Tree or index nodes, including unused space of their allocations
+  std::size_t structure = 0;
+
+  /// Cached responses and results
+  std::size_t caches = 0;
+
+  std::size_t total() const
+  {
+    return keys + values + structure + caches;
+  }
+};
+
+/// Time spent in a phase of creating and first using a backend
+struct Phase {
+  /// One of "uri" (parsing the URI), "files" (checking files exist), "connect", "transfer", "parse",
+  /// "index" (building the lookup tree), "prefetch" and "lookup" (the first get)
+  std::string name;
+
+  std::chrono::nanoseconds duration;
+};
+
 /// \brief Interface for configuration back ends.
 ///
 /// Interface for configuration back-ends, to put and get configuration parameters.
@@ -63,6 +98,14 @@ class ConfigurationInterface
     /// \param tree Tree-like data structure
     virtual void putRecursive(const std::string& path, const boost::property_tree::ptree& tree);
 
+    /// Removes a value from the configuration
+    /// \param path The path of the value
+    virtual void erase(const std::string& path);
+
+    /// Writes out values buffered by previous put operations
+    /// Backends that write values immediately have nothing to flush.
+    virtual void flush();
+
     /// Template convenience interface for get operations.
     /// \param path The path of the value
     /// \return The retrieved value.
@@ -76,6 +119,26 @@ class ConfigurationInterface
     template<typename T>
     T get(const std::string& path, const T& defaultValue);
 
+    /// Template convenience interface for getting arrays of numbers
+    /// Elements are the children of the given path, e.g. items of a JSON array.
+    /// \param T The type of the elements. Supported types are "int", "long", "float" and "double"
+    /// \param path The path of the array
+    /// \return The retrieved elements
+    /// \throw std::runtime_error when an element is not a number of the requested type
+    template<typename T>
+    std::vector<T> getArray(const std::string& path);
+
+    /// Template convenience interface for getting arrays of numbers into memory of the caller
+    /// Elements are read from the values held by the backend, without building a tree.
+    /// \param T The type of the elements. Supported types are "int", "long", "float" and "double"
+    /// \param path The path of the array
+    /// \param values Where the elements are written
+    /// \param size Number of elements values has room for
+    /// \return Number of elements written
+    /// \throw std::runtime_error when an element is not a number of the requested type, or there are more than size
+    template<typename T>
+    std::size_t getArray(const std::string& path, T* values, std::size_t size);
+
     /// Sets a prefix
     /// After this call, all paths given to this object will be prefixed with this.
     /// The implementation of this is very backend-dependent and it may not be a trivial call.
@@ -87,10 +150,71 @@ class ConfigurationInterface
     /// \return A map containing the key-values
     virtual KeyValueMap getRecursiveMap(const std::string& path = {}) = 0;
 
+    /// Gets key-values recursively from the given path as a shared, immutable map
+    /// Backends holding values in memory return the same map for repeated calls until their data changes.
+    /// \param path The path of the values to get
+    /// \return A shared map containing the key-values
+    virtual std::shared_ptr<const KeyValueMap> getRecursiveMapShared(const std::string& path = {});
+
+    /// Gets key-values whose paths match a pattern
+    /// Segments of the pattern may be wildcards: "*" matches exactly one segment, "**" any number of segments,
+    /// e.g. "qc.tasks.*.moduleName" or "links.**.enabled".
+    /// \param pattern The pattern
+    /// \return A map containing the matching key-values, by full path
+    virtual KeyValueMap getMatching(const std::string& pattern);
+
+    /// Lists names of keys under a path without their values
+    /// \param path The path whose keys to list
+    /// \param recursive Whether to list the paths of all leaves under the path, relative to it, instead of the names
+    ///                  of its immediate children; nodes which only have children, like Consul folders, are no leaves
+    /// \return Sorted names, empty when the path does not exist
+    virtual std::vector<std::string> listKeys(const std::string& path, bool recursive = false);
+
     /// Provides subtree from given path
     /// \param path The path to the subtree
     /// \return Subtree
     virtual boost::property_tree::ptree getRecursive(const std::string& path = {}) = 0;
+
+    /// Fetches keys and prefixes concurrently into the backend's cache
+    /// Subsequent get operations on prefetched paths are served from memory.
+    /// Backends holding all values in memory have nothing to prefetch.
+    /// \param paths Keys or prefixes to fetch
+    /// \param timeout Maximum time to wait, paths not fetched by then are read on demand
+    virtual void prefetch(const std::vector<std::string>& paths, std::chrono::milliseconds timeout);
+
+    /// Brings values cached by the backend up to date
+    /// Backends that do not cache remote values have nothing to refresh.
+    virtual void refresh();
+
+    /// Tells whether the backend reached its server when it last tried
+    /// Backends serving stale values when the server is unreachable report false until it is reached again.
+    virtual bool isHealthy();
+
+    /// Reports memory held by the backend
+    /// Trees of file backends are measured by the memory resource they are allocated from.
+    virtual MemoryUsage memoryUsage();
+
+    /// Reports time spent in each phase of creating and first using the backend, in the order the phases occurred
+    /// Phases of creating a backend are recorded when it is created by ConfigurationFactory.
+    virtual std::vector<Phase> getStartupProfile();
+
+  protected:
+    /// Filters getRecursiveMap() of the literal prefix of a pattern, the default implementation of getMatching()
+    /// \param pattern The pattern
+    /// \param separator Separator of path segments used by the backend
+    KeyValueMap filterMatching(const std::string& pattern, char separator);
+
+    /// Walks getRecursive() of a path, the default implementation of listKeys()
+    /// \param path The path whose keys to list
+    /// \param recursive Whether to list the paths of all leaves instead of the names of the immediate children
+    /// \param separator Separator of path segments used by the backend
+    std::vector<std::string> listTreeKeys(const std::string& path, bool recursive, char separator);
+
+    /// Passes the values of the children of a path to a function, in order, used by getArray()
+    /// The default implementation goes through getRecursive().
+    /// \param path The path of the parent
+    /// \param visit Called with the value of each child
+    virtual void visitChildren(const std::string& path, const std::function<void(std::string_view)>& visit);
 };
 
 } // namespace configuration
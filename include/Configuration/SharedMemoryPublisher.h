@@ -0,0 +1,75 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SharedMemoryPublisher.h
+/// \brief Publishes configuration snapshots to processes on the same node
+///
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_SHAREDMEMORYPUBLISHER_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_SHAREDMEMORYPUBLISHER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <boost/property_tree/ptree.hpp>
+#include "Configuration/ConfigurationInterface.h"
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+namespace shm
+{
+class Segment;
+}
+}
+
+/// Writes configuration snapshots into POSIX shared memory, where the shm://name backend reads them
+/// Each publication creates a new version, readers switch to it on their next get operation.
+/// The previous version is kept for readers still using it, older versions are removed.
+class SharedMemoryPublisher
+{
+  public:
+    /// Opens or creates the snapshot, versions continue from those of a previous publisher of the same name
+    /// \param name Name of the snapshot, as in shm://name
+    SharedMemoryPublisher(const std::string& name);
+
+    /// Removes the published values, processes which already mapped them keep them
+    /// The control segment stays, so that readers pick up the versions of a publisher started again.
+    ~SharedMemoryPublisher();
+
+    /// Removes a snapshot with its control segment, once no publisher of it will be started again
+    /// \param name Name of the snapshot, as in shm://name
+    static void remove(const std::string& name);
+
+    /// Publishes values as a new version
+    /// \param tree Values to publish
+    /// \return Version of the published snapshot
+    uint64_t publish(const boost::property_tree::ptree& tree);
+
+    /// Publishes all values of a configuration as a new version
+    /// \param configuration Source of the values
+    /// \return Version of the published snapshot
+    uint64_t publish(ConfigurationInterface& configuration);
+
+  private:
+    std::string mName;
+
+    /// Mapped control segment
+    std::unique_ptr<backends::shm::Segment> mControl;
+};
+
+} // namespace configuration
+} // namespace o2
+
+#endif // ALICEO2_CONFIGURATION_INCLUDE_SHAREDMEMORYPUBLISHER_H_
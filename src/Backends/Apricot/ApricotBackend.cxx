@@ -15,7 +15,12 @@
 /// \author Pascal Boeschoten, CERN
 
 #include "ApricotBackend.h"
+#include "../Footprint.h"
+#include "../Json/JsonFlattener.h"
 #include <boost/property_tree/json_parser.hpp>
+#include <exception>
+#include <list>
+#include <stdexcept>
 
 namespace o2
 {
@@ -24,27 +29,163 @@ namespace configuration
 namespace backends
 {
 
-std::size_t WriteData(const char* in, std::size_t size, std::size_t num, std::string* out) {
+/// State of a response being received
+struct Response {
+  /// Handle running the request
+  CURL* handle;
+
+  /// Consumer of the body
+  const std::function<void(const char*, std::size_t)>& consume;
+
+  /// Response whose body is consumed, the first one to receive a body of requests sent for the same key
+  Response** winner;
+
+  /// Requested URL
+  std::string url;
+
+  /// Whether the status code was checked already
+  bool checked = false;
+
+  /// Whether the status code indicates success, body of other responses is ignored
+  bool accepted = false;
+
+  /// Exception thrown by the consumer, it cannot pass through CURL
+  std::exception_ptr error;
+
+  /// Whether the request finished
+  bool done = false;
+
+  /// Result of the finished request
+  CURLcode result = CURLE_OK;
+
+  /// Status code of the finished request
+  long responseCode = 0;
+};
+
+/// Failure worth retrying: a transfer error or a server error status
+struct TransferError : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+bool isTransient(const std::exception& error)
+{
+  return dynamic_cast<const TransferError*>(&error) != nullptr;
+}
+
+std::size_t WriteData(const char* in, std::size_t size, std::size_t num, Response* response) {
     const std::size_t totalBytes(size * num);
-    out->append(in, totalBytes);
+    if (!response->checked) {
+      long responseCode;
+      curl_easy_getinfo(response->handle, CURLINFO_RESPONSE_CODE, &responseCode);
+      response->accepted = responseCode >= 200 && responseCode <= 206;
+      response->checked = true;
+    }
+    if (!response->accepted) {
+      return totalBytes;
+    }
+    // Of requests sent for the same key, only the first to receive a body is consumed
+    if (*response->winner == nullptr) {
+      *response->winner = response;
+    } else if (*response->winner != response) {
+      return 0;
+    }
+    try {
+      response->consume(in, totalBytes);
+    } catch (...) {
+      response->error = std::current_exception();
+      return 0;
+    }
     return totalBytes;
 };
 
+void LockShare(CURL* /*handle*/, curl_lock_data data, curl_lock_access /*access*/, void* locks) {
+  static_cast<std::mutex*>(locks)[data].lock();
+}
+
+void UnlockShare(CURL* /*handle*/, curl_lock_data data, void* locks) {
+  static_cast<std::mutex*>(locks)[data].unlock();
+}
+
 ApricotBackend::ApricotBackend(const std::string& host, int port) :
-    mUrl(host + ":" + std::to_string(port))
+    mUrls{ host + ":" + std::to_string(port) }
 {
-  mCurl = curl_easy_init();
-  curl_easy_setopt(mCurl, CURLOPT_SSL_VERIFYPEER, 0); 
-  curl_easy_setopt(mCurl, CURLOPT_CONNECTTIMEOUT, 3);
-  curl_easy_setopt(mCurl, CURLOPT_TIMEOUT, 3);
+  mShare = curl_share_init();
+  curl_share_setopt(mShare, CURLSHOPT_LOCKFUNC, LockShare);
+  curl_share_setopt(mShare, CURLSHOPT_UNLOCKFUNC, UnlockShare);
+  curl_share_setopt(mShare, CURLSHOPT_USERDATA, mShareLocks.data());
+  // The connection cache cannot be shared by handles running in different threads,
+  // connections are kept by the multi handles of the pool instead
+  curl_share_setopt(mShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(mShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
 }
 
 ApricotBackend::~ApricotBackend()
 {
-  curl_easy_cleanup(mCurl);
+  mPrefetcher.join();
+  mResponseCache.stop();
+  mMapCache.stop();
+  for (auto multi : mIdleMultis) {
+    curl_multi_cleanup(multi);
+  }
+  for (auto handle : mIdleHandles) {
+    curl_easy_cleanup(handle);
+  }
+  curl_share_cleanup(mShare);
   curl_global_cleanup();
 }
 
+CURL* ApricotBackend::acquireHandle(bool wait)
+{
+  std::unique_lock<std::mutex> lock(mPoolMutex);
+  if (!wait && mIdleHandles.empty() && mHandleCount >= mPoolSize) {
+    return nullptr;
+  }
+  mPoolCondition.wait(lock, [this] { return !mIdleHandles.empty() || mHandleCount < mPoolSize; });
+  if (!mIdleHandles.empty()) {
+    auto handle = mIdleHandles.back();
+    mIdleHandles.pop_back();
+    return handle;
+  }
+  mHandleCount++;
+  lock.unlock();
+
+  auto handle = curl_easy_init();
+  curl_easy_setopt(handle, CURLOPT_SHARE, mShare);
+  curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0);
+  // Use HTTP/2 when negotiated by the server
+  curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+  curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteData);
+  return handle;
+}
+
+void ApricotBackend::releaseHandle(CURL* handle)
+{
+  {
+    std::lock_guard<std::mutex> lock(mPoolMutex);
+    mIdleHandles.push_back(handle);
+  }
+  mPoolCondition.notify_one();
+}
+
+CURLM* ApricotBackend::acquireMulti()
+{
+  {
+    std::lock_guard<std::mutex> lock(mPoolMutex);
+    if (!mIdleMultis.empty()) {
+      auto multi = mIdleMultis.back();
+      mIdleMultis.pop_back();
+      return multi;
+    }
+  }
+  return curl_multi_init();
+}
+
+void ApricotBackend::releaseMulti(CURLM* multi)
+{
+  std::lock_guard<std::mutex> lock(mPoolMutex);
+  mIdleMultis.push_back(multi);
+}
+
 auto ApricotBackend::replaceDefaultWithSlash(const std::string& path) -> std::string
 {
   auto p = path;
@@ -59,34 +200,200 @@ void ApricotBackend::putString(const std::string& /*path*/, const std::string& /
 
 boost::optional<std::string> ApricotBackend::getString(const std::string& path)
 {
+  auto lookup = measureFirstLookup();
+  auto prefetched = getPrefetched(addApricotPrefix(path), true);
+  if (prefetched) {
+    return prefetched;
+  }
   return get(path);
 }
 
+void ApricotBackend::prefetch(const std::vector<std::string>& paths, std::chrono::milliseconds timeout)
+{
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  std::vector<std::string> keys;
+  for (const auto& path : paths) {
+    keys.push_back(addApricotPrefix(path));
+  }
+  mPrefetcher.start(keys, [this](const std::string& key) { return request(key); }, mPoolSize);
+  mPrefetcher.wait(deadline);
+}
+
+boost::optional<std::string> ApricotBackend::getPrefetched(const std::string& key, bool leafOnly)
+{
+  std::lock_guard<std::mutex> lock(mPrefetchMutex);
+  for (auto& result : mPrefetcher.collect()) {
+    boost::property_tree::ptree tree;
+    try {
+      std::istringstream ss(result.second);
+      boost::property_tree::read_json(ss, tree);
+      mPrefetchedTrees[result.first] = std::move(tree);
+    } catch (const boost::property_tree::ptree_error&) {
+      // Not a JSON document, but a single value
+    }
+    mPrefetched[result.first] = std::move(result.second);
+  }
+
+  auto prefetched = mPrefetched.find(key);
+  if (prefetched != mPrefetched.end() && (!leafOnly || !mPrefetchedTrees.count(key))) {
+    return prefetched->second;
+  }
+
+  // Look for the value inside of a prefetched ancestor
+  for (auto separator = key.rfind(getSeparator()); separator != std::string::npos && separator > 0;
+       separator = key.rfind(getSeparator(), separator - 1)) {
+    auto tree = mPrefetchedTrees.find(key.substr(0, separator));
+    if (tree == mPrefetchedTrees.end()) {
+      continue;
+    }
+    auto child = tree->second.get_child_optional(
+      boost::property_tree::ptree::path_type(key.substr(separator + 1), getSeparator()));
+    if (child && child->empty()) {
+      return child->data();
+    }
+    break;
+  }
+  return {};
+}
+
+std::string ApricotBackend::get(const std::string& path)
+{
+  auto key = addApricotPrefix(path);
+  auto prefetched = getPrefetched(key, false);
+  if (prefetched) {
+    return *prefetched;
+  }
+  if (mResponseCache.isEnabled()) {
+    return mResponseCache.get(key, [this, key]() { return request(key); });
+  }
+  return request(key);
+}
+
+std::string ApricotBackend::request(const std::string& key) {
+  return mRequests.run(key, [this, &key]() {
+    return retry<std::string>(mRetryPolicy, [this, &key](unsigned attempt) {
+      std::string response;
+      request(key, [&response](const char* data, std::size_t size) { response.append(data, size); }, attempt);
+      return response;
+    }, isTransient);
+  });
+}
+
+SingleFlightStatistics ApricotBackend::getRequestStatistics()
+{
+  auto statistics = mRequests.getStatistics();
+  auto mapStatistics = mMapRequests.getStatistics();
+  statistics.requests += mapStatistics.requests;
+  statistics.coalesced += mapStatistics.coalesced;
+  return statistics;
+}
 
-std::string ApricotBackend::get(const std::string& path) {
-  std::string response;
-  std::string url = mUrl + "/" + replaceDefaultWithSlash(addApricotPrefix(path)) +  mQueryParams;
-  CURLcode res;
-  long responseCode;
-  curl_easy_setopt(mCurl, CURLOPT_URL, url.c_str());
-  curl_easy_setopt(mCurl, CURLOPT_WRITEFUNCTION, WriteData);
-  curl_easy_setopt(mCurl, CURLOPT_WRITEDATA, &response);
+void ApricotBackend::request(const std::string& key, const std::function<void(const char*, std::size_t)>& consume,
+                             unsigned attempt) {
+  std::string path = "/" + replaceDefaultWithSlash(key) + mQueryParams;
 
-  res = curl_easy_perform(mCurl);
-  curl_easy_getinfo(mCurl, CURLINFO_RESPONSE_CODE, &responseCode);
+  // Requests run on a multi handle, so that a hedged request can run next to the first one in this thread.
+  // The multi handle holds the connections, it is taken after the first handle so that there are no more
+  // multi handles than handles.
+  auto first = acquireHandle();
+  auto multi = acquireMulti();
+  std::list<Response> responses;
+  Response* winner = nullptr;
+  auto send = [&](CURL* curl, unsigned endpoint) {
+    auto& response = responses.emplace_back(Response{curl, consume, &winner, mUrls[endpoint % mUrls.size()] + path, false, false, nullptr, false, CURLE_OK, 0});
+    curl_easy_setopt(curl, CURLOPT_URL, response.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, &response);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(mConnectTimeout.count()));
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(mTimeout.count()));
+    curl_multi_add_handle(multi, curl);
+  };
+  auto start = std::chrono::steady_clock::now();
+  auto hedgeAt = std::chrono::steady_clock::time_point::max();
+  if (mRetryPolicy.hedgePercentile > 0) {
+    auto latency = mLatencies.percentile(mRetryPolicy.hedgePercentile);
+    if (latency) {
+      hedgeAt = start + *latency;
+    }
+  }
+  send(first, attempt);
+
+  Response* finished = nullptr;
+  while (finished == nullptr) {
+    int running;
+    curl_multi_perform(multi, &running);
+    int queued;
+    while (auto message = curl_multi_info_read(multi, &queued)) {
+      if (message->msg != CURLMSG_DONE) {
+        continue;
+      }
+      Response* response;
+      curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &response);
+      curl_easy_getinfo(message->easy_handle, CURLINFO_RESPONSE_CODE, &response->responseCode);
+      response->done = true;
+      response->result = message->data.result;
+    }
+
+    // The response whose body is consumed decides, otherwise the first one to complete,
+    // a failed request is decisive only when no other one is running
+    bool allDone = true;
+    for (auto& response : responses) {
+      allDone = allDone && response.done;
+      if (response.done && (winner == &response || (winner == nullptr && response.result == CURLE_OK))) {
+        finished = &response;
+      }
+    }
+    if (finished == nullptr && allDone) {
+      finished = &responses.back();
+    }
+    if (finished != nullptr) {
+      break;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    bool hedgePending = hedgeAt != std::chrono::steady_clock::time_point::max() && responses.size() == 1 && winner == nullptr;
+
+    if (hedgePending && now >= hedgeAt) {
+      // Hedging is skipped rather than waiting for a handle when the pool is exhausted
+      auto curl = acquireHandle(false);
+      if (curl != nullptr) {
+        send(curl, attempt + 1);
+      }
+      hedgeAt = std::chrono::steady_clock::time_point::max();
+      continue;
+    }
+    auto timeout = std::chrono::milliseconds(1000);
+    if (hedgePending) {
+      timeout = std::min(timeout, std::chrono::ceil<std::chrono::milliseconds>(hedgeAt - now));
+    }
+    curl_multi_poll(multi, nullptr, 0, static_cast<int>(timeout.count()), nullptr);
+  }
+
+  for (auto& response : responses) {
+    curl_multi_remove_handle(multi, response.handle);
+    releaseHandle(response.handle);
+  }
+  releaseMulti(multi);
 
-  if (res != CURLE_OK) {
-    throw std::runtime_error(std::string(curl_easy_strerror(res)) + " " + url);
-    return {}; 
+  if (finished->error) {
+    std::rethrow_exception(finished->error);
   }
-  if (responseCode < 200 || responseCode > 206) {
-    throw std::runtime_error("Wrong status code: " + std::to_string(responseCode));
+  if (finished->result != CURLE_OK) {
+    throw TransferError(std::string(curl_easy_strerror(finished->result)) + " " + finished->url);
   }
-  return response;
+  if (finished->responseCode < 200 || finished->responseCode > 206) {
+    auto message = "Wrong status code: " + std::to_string(finished->responseCode);
+    if (finished->responseCode >= 500 || finished->responseCode == 429) {
+      throw TransferError(message);
+    }
+    throw std::runtime_error(message);
+  }
+  mLatencies.record(std::chrono::steady_clock::now() - start);
 }
 
 boost::property_tree::ptree ApricotBackend::getRecursive(const std::string& path)
 {
+  auto lookup = measureFirstLookup();
   std::istringstream ss; 
   ss.str(get(path));
   boost::property_tree::ptree tree;
@@ -96,20 +403,52 @@ boost::property_tree::ptree ApricotBackend::getRecursive(const std::string& path
 
 KeyValueMap ApricotBackend::getRecursiveMap(const std::string& path)
 {
-  KeyValueMap map;
-  auto subTree = getRecursive(path);
-
-  // define lambda to recursively interate tree
-  using boost::property_tree::ptree;
-  std::function<void(const ptree&, std::string)> parse = [&](const ptree& node, std::string key) {
-    map[key] = std::move(node.data());
-    key = key.empty() ? "" : key + getSeparator();
-    for (auto const &it: node) {
-      parse(it.second, key + it.first);
-    }   
-  };  
-  parse(subTree, std::string());
-  return map;
+  auto lookup = measureFirstLookup();
+  // Values are parsed while the response is being received, without building a tree
+  auto key = addApricotPrefix(path);
+  auto prefetched = getPrefetched(key, false);
+  if (prefetched) {
+    KeyValueMap map;
+    JsonFlattener flattener(map, getSeparator());
+    flattener.feed(prefetched->data(), prefetched->size());
+    flattener.finish();
+    return map;
+  }
+  auto fetch = [this, key]() {
+    return mMapRequests.run(key, [this, &key]() {
+      // Each attempt parses the body from the start
+      return retry<KeyValueMap>(mRetryPolicy, [this, &key](unsigned attempt) {
+        KeyValueMap map;
+        JsonFlattener flattener(map, getSeparator());
+        request(key, [&flattener](const char* data, std::size_t size) { flattener.feed(data, size); }, attempt);
+        flattener.finish();
+        return map;
+      }, isTransient);
+    });
+  };
+  return mMapCache.isEnabled() ? mMapCache.get(key, fetch) : fetch();
+}
+
+void ApricotBackend::setStaleTtl(std::chrono::milliseconds soft, std::chrono::milliseconds hard)
+{
+  mResponseCache.setTtl(soft, hard);
+  mMapCache.setTtl(soft, hard);
+}
+
+bool ApricotBackend::isHealthy()
+{
+  return mResponseCache.isHealthy() && mMapCache.isHealthy();
+}
+
+MemoryUsage ApricotBackend::memoryUsage()
+{
+  MemoryUsage usage;
+  {
+    std::lock_guard<std::mutex> lock(mPrefetchMutex);
+    usage.caches = footprint(mPrefetched) - sizeof(mPrefetched) + footprint(mPrefetchedTrees) - sizeof(mPrefetchedTrees);
+  }
+  usage.caches += mResponseCache.getFootprint() + mMapCache.getFootprint();
+  return usage;
 }
 
 } // namespace backends
@@ -19,8 +19,19 @@
 #define O2_CONFIGURATION_BACKENDS_APRICOTBACKEND_H_
 
 #include "../BackendBase.h"
+#include "../Prefetcher.h"
+#include "../Retry.h"
+#include "../SingleFlight.h"
+#include "../StaleCache.h"
 #include <curl/curl.h>
+#include <array>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace o2
 {
@@ -42,6 +53,8 @@ class ApricotBackend final : public BackendBase
     virtual KeyValueMap getRecursiveMap(const std::string&) override;
     virtual boost::property_tree::ptree getRecursive(const std::string& path) override;
 
+    /// Fetches paths concurrently, using up to pool size connections
+    virtual void prefetch(const std::vector<std::string>& paths, std::chrono::milliseconds timeout) override;
 
     void setBasePrefix(const std::string& path)
     {
@@ -60,18 +73,120 @@ class ApricotBackend final : public BackendBase
       mQueryParams = params;
     }
 
+    /// Sets maximum number of concurrent requests, each using its own CURL handle
+    /// \param size Number of handles in the pool
+    void setPoolSize(std::size_t size)
+    {
+      mPoolSize = size == 0 ? 1 : size;
+    }
+
+    /// Adds an endpoint serving the same data, used by retries and hedged requests
+    void addReplica(const std::string& host, int port)
+    {
+      mUrls.push_back(host + ":" + std::to_string(port));
+    }
+
+    /// Sets retries of failed requests and hedging of slow ones
+    void setRetryPolicy(const RetryPolicy& policy)
+    {
+      mRetryPolicy = policy;
+    }
+
+    /// Sets timeouts of a single request
+    /// \param connect Timeout of establishing the connection
+    /// \param total Timeout of the whole request
+    void setTimeouts(std::chrono::milliseconds connect, std::chrono::milliseconds total)
+    {
+      mConnectTimeout = connect;
+      mTimeout = total;
+    }
+
+    /// Enables serving cached responses at once while refreshing them in the background
+    /// \param soft Age after which a response is refreshed in the background, zero disables the cache
+    /// \param hard Age after which a response is requested before returning, zero to always return the cached one
+    void setStaleTtl(std::chrono::milliseconds soft, std::chrono::milliseconds hard);
+
+    /// Tells whether the last request of the stale-while-revalidate cache reached Apricot
+    virtual bool isHealthy() override;
+
+    /// Prefetched values and cached responses, all reported as caches
+    virtual MemoryUsage memoryUsage() override;
+
+    /// Reports requests made and requests saved by coalescing concurrent identical ones
+    SingleFlightStatistics getRequestStatistics();
+
   private:
+    /// Default number of CURL handles in the pool
+    static constexpr std::size_t DEFAULT_POOL_SIZE = 4;
+
     /// Query params
     std::string mQueryParams;
 
     /// Base prefix
     std::string mBasePrefix;
 
-    /// CURL handle
-    CURL *mCurl;
+    /// Shared DNS and TLS session cache of all handles
+    CURLSH *mShare;
+
+    /// Locks of the data shared by handles, indexed by curl_lock_data
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> mShareLocks;
+
+    /// CURL handles not used by any request
+    std::vector<CURL*> mIdleHandles;
+
+    /// Multi handles not used by any request, each keeps the connections of the requests it ran
+    std::vector<CURLM*> mIdleMultis;
 
-    /// Apricot URL
-    std::string mUrl;
+    /// Number of CURL handles created so far
+    std::size_t mHandleCount = 0;
+
+    /// Maximum number of CURL handles
+    std::size_t mPoolSize = DEFAULT_POOL_SIZE;
+
+    /// Guards the idle handles and multi handles
+    std::mutex mPoolMutex;
+
+    /// Notifies about handles returned to the pool
+    std::condition_variable mPoolCondition;
+
+    /// Prefetched responses, by full key
+    std::unordered_map<std::string, std::string> mPrefetched;
+
+    /// Prefetched responses which are JSON documents, by full key
+    std::map<std::string, boost::property_tree::ptree> mPrefetchedTrees;
+
+    /// Guards prefetched responses
+    std::mutex mPrefetchMutex;
+
+    /// Prefetch requests
+    Prefetcher<std::string> mPrefetcher;
+
+    /// Coalesces concurrent requests of the same key
+    SingleFlight<std::string> mRequests;
+
+    /// Coalesces concurrent getRecursiveMap() requests of the same key
+    SingleFlight<KeyValueMap> mMapRequests;
+
+    /// Stale-while-revalidate cache of responses, by full key
+    StaleCache<std::string> mResponseCache;
+
+    /// Stale-while-revalidate cache of getRecursiveMap(), by full key
+    StaleCache<KeyValueMap> mMapCache;
+
+    /// Apricot URLs, the first one is used by first attempts, the others by retries and hedged requests
+    std::vector<std::string> mUrls;
+
+    /// Retries and hedging
+    RetryPolicy mRetryPolicy;
+
+    /// Latencies of recent requests, the hedging threshold is taken from them
+    LatencyWindow mLatencies;
+
+    /// Timeout of establishing a connection
+    std::chrono::milliseconds mConnectTimeout{ 3000 };
+
+    /// Timeout of a whole request
+    std::chrono::milliseconds mTimeout{ 3000 };
 
     /// Replaces DEFAULT_SEPARATOR with '/', this is required by ppconsul
     /// \param path A path with DEFAULT_SEPARATOR
@@ -83,9 +198,39 @@ class ApricotBackend final : public BackendBase
     /// \return A path with DEFAULT_SEPARATOR
     std::string replaceSlashWithDefault(const std::string& path);
 
-    /// Runs request against Apricot server
+    /// Gets response for a path, from prefetched responses or from Apricot server
     std::string get(const std::string& path);
 
+    /// Runs request against Apricot server
+    /// \param key Full key, including base prefix and prefix
+    std::string request(const std::string& key);
+
+    /// Runs request against Apricot server, passing the response body to a consumer as it arrives
+    /// When the request takes longer than the hedging percentile, a second one is sent to the next endpoint
+    /// and the body of the first one to respond is consumed.
+    /// \param key Full key, including base prefix and prefix
+    /// \param consume Consumer of the body chunks
+    /// \param attempt Number of the attempt, selecting the endpoint
+    void request(const std::string& key, const std::function<void(const char*, std::size_t)>& consume, unsigned attempt);
+
+    /// Looks up a value in prefetched responses
+    /// \param key Full key, including base prefix and prefix
+    /// \param leafOnly Whether to find only values which are not objects, as those are returned as JSON by Apricot
+    boost::optional<std::string> getPrefetched(const std::string& key, bool leafOnly);
+
+    /// Takes an idle handle from the pool, creates one when the pool is not full or waits for one
+    /// \param wait Whether to wait for a handle, otherwise nullptr is returned when the pool is exhausted
+    CURL* acquireHandle(bool wait = true);
+
+    /// Returns a handle to the pool
+    void releaseHandle(CURL* handle);
+
+    /// Takes an idle multi handle from the pool, or creates one
+    CURLM* acquireMulti();
+
+    /// Returns a multi handle to the pool, its connections stay open for the next request
+    void releaseMulti(CURLM* multi);
+
     /// Adds base prefix to requested path
     auto addApricotPrefix(const std::string& path)
     {
@@ -18,8 +18,10 @@
 #ifndef O2_CONFIGURATION_BACKENDBASE_H_
 #define O2_CONFIGURATION_BACKENDBASE_H_
 
+#include <atomic>
 #include <boost/core/noncopyable.hpp>
 #include "Configuration/ConfigurationInterface.h"
+#include "PhaseProfiler.h"
 
 namespace o2 {
 namespace configuration {
@@ -46,6 +48,18 @@ class BackendBase: public ConfigurationInterface, public boost::noncopyable
       throw std::runtime_error("getRecursiveMap() unsupported by backend");
     }
 
+    /// Filters getRecursiveMap() of the literal prefix of the pattern, using the separator of the backend
+    virtual KeyValueMap getMatching(const std::string& pattern) override
+    {
+      return filterMatching(pattern, getSeparator());
+    }
+
+    /// Walks getRecursive() of the path, using the separator of the backend
+    virtual std::vector<std::string> listKeys(const std::string& path, bool recursive) override
+    {
+      return listTreeKeys(path, recursive, getSeparator());
+    }
+
     /// Sets path prefix
     /// \param A path prefix
     virtual void setPrefix(const std::string& prefix) override
@@ -53,6 +67,17 @@ class BackendBase: public ConfigurationInterface, public boost::noncopyable
       mPrefix = prefix.empty() ? "" : prefix + getSeparator();
     }
 
+    virtual std::vector<Phase> getStartupProfile() override
+    {
+      return mProfiler.get();
+    }
+
+    /// Adds phases of creating the backend, recorded by the factory
+    void addStartupPhases(const backends::PhaseProfiler& profiler)
+    {
+      mProfiler.merge(profiler);
+    }
+
   protected:
     /// Prepends path with prefix
     /// \param path A path
@@ -62,12 +87,25 @@ class BackendBase: public ConfigurationInterface, public boost::noncopyable
       return mPrefix + path;
     }
 
+    /// Measures the first lookup until the returned scope is destroyed, later lookups are not measured
+    backends::PhaseProfiler::Scope measureFirstLookup()
+    {
+      auto first = !mLookedUp.load(std::memory_order_relaxed) && !mLookedUp.exchange(true);
+      return backends::PhaseProfiler::Scope(first ? &mProfiler : nullptr, "lookup");
+    }
+
   private:
     /// Default separator for keys/paths
     static constexpr char DEFAULT_SEPARATOR = '.';
 
     /// Get path prefix
     std::string mPrefix;
+
+    /// Phases of creating and first using the backend
+    backends::PhaseProfiler mProfiler;
+
+    /// Whether the first lookup was measured
+    std::atomic<bool> mLookedUp{ false };
 };
 
 } // namespace configuration
@@ -15,6 +15,16 @@
 /// \author Pascal Boeschoten, CERN
 
 #include "ConsulBackend.h"
+#include "../Footprint.h"
+#include "../PathPattern.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
 
 namespace o2
 {
@@ -25,6 +35,66 @@ namespace backends
 namespace
 {
 
+/// Maximum number of operations accepted by Consul in a single transaction
+constexpr std::size_t MAX_TXN_OPERATIONS = 64;
+
+/// Payload limit of a single transaction, kept below Consul's default of 512 kB
+/// as values are base64 encoded in the request
+constexpr std::size_t MAX_TXN_BYTES = 256 * 1024;
+
+/// Number of transactions sent concurrently
+constexpr std::size_t MAX_TXN_IN_FLIGHT = 4;
+
+/// Splits listed keys into transactions reading at most pageSize keys each
+/// Folders with few enough keys are read as a whole, keys of larger folders one by one.
+/// \param keys Sorted keys listed under the request key
+/// \param requestKey Key prefix the keys were listed with
+/// \param pageSize Maximum number of keys per transaction
+auto planPages(const std::vector<std::string>& keys, const std::string& requestKey, std::size_t pageSize)
+  -> std::vector<std::vector<ppconsul::kv::TxnOperation>>
+{
+  std::vector<std::vector<ppconsul::kv::TxnOperation>> pages;
+  std::size_t pageKeys = 0;
+  auto add = [&](ppconsul::kv::TxnOperation operation, std::size_t count) {
+    if (pages.empty() || pages.back().size() == MAX_TXN_OPERATIONS || pageKeys + count > pageSize) {
+      pages.emplace_back();
+      pageKeys = 0;
+    }
+    pages.back().push_back(std::move(operation));
+    pageKeys += count;
+  };
+  std::function<void(std::size_t, std::size_t, const std::string&)> split = [&](std::size_t begin, std::size_t end,
+                                                                                const std::string& prefix) {
+    if (end - begin <= pageSize) {
+      add(ppconsul::kv::txn_ops::GetAll{ prefix }, end - begin);
+      return;
+    }
+    // Keys of a subfolder are adjacent in the sorted listing
+    for (auto i = begin; i < end;) {
+      auto slash = keys[i].find('/', prefix.size());
+      if (slash == std::string::npos) {
+        add(ppconsul::kv::txn_ops::Get{ keys[i] }, 1);
+        i++;
+        continue;
+      }
+      auto folder = keys[i].substr(0, slash + 1);
+      auto next = i + 1;
+      while (next < end && keys[next].compare(0, folder.size(), folder) == 0) {
+        next++;
+      }
+      split(i, next, folder);
+      i = next;
+    }
+  };
+  if (!keys.empty()) {
+    split(0, keys.size(), requestKey);
+  }
+  return pages;
+}
+
+/// Number of prefetch requests sent concurrently
+constexpr std::size_t MAX_PREFETCH_IN_FLIGHT = 8;
+
 auto stripRequestKey(const std::string& requestKey, const std::string& response) -> std::string
 {
   int length = requestKey.length();
@@ -34,11 +104,107 @@ auto stripRequestKey(const std::string& requestKey, const std::string& response)
   }
   return response.substr(length);
 }
+
+/// Tells whether a key is the prefix itself or a key in the folder of the prefix
+bool isUnderPrefix(const std::string& key, const std::string& prefix)
+{
+  if (key.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  return key.size() == prefix.size() || prefix.empty() || prefix.back() == '/' || key[prefix.size()] == '/';
+}
+
+/// Errors worth retrying are server error statuses and connection errors, which the HTTP client of ppconsul reports
+/// as std::runtime_error; other errors, e.g. missing keys, aborted transactions, invalid responses or std::bad_alloc,
+/// are thrown at once
+bool isTransient(const std::exception& error)
+{
+  if (auto status = dynamic_cast<const ppconsul::BadStatus*>(&error)) {
+    return status->code() >= 500;
+  }
+  return dynamic_cast<const ppconsul::Error*>(&error) == nullptr && dynamic_cast<const std::runtime_error*>(&error) != nullptr;
+}
+
+/// Calls a function when leaving the scope, also by an exception
+template <typename Function>
+class ScopeExit
+{
+  public:
+    explicit ScopeExit(Function function) : mFunction(std::move(function))
+    {
+    }
+
+    ~ScopeExit()
+    {
+      mFunction();
+    }
+
+  private:
+    Function mFunction;
+};
 } // Anonymous namespace
 
 ConsulBackend::ConsulBackend(const std::string& host, int port) :
-    mConsul(host + ":" + std::to_string(port)), mStorage(mConsul)
+    mEndpoints{ host + ":" + std::to_string(port) }
+{
+  mIdleConnections.push_back(connect(0));
+}
+
+auto ConsulBackend::connect(std::size_t endpoint) -> std::unique_ptr<Connection>
+{
+  auto connecting = PhaseProfiler::measure("connect");
+  auto connection = std::make_unique<Connection>();
+  connection->endpoint = endpoint;
+  connection->consul = std::make_unique<ppconsul::Consul>(mEndpoints[endpoint]);
+  connection->storage = std::make_unique<ppconsul::kv::Kv>(*connection->consul);
+  return connection;
+}
+
+std::size_t ConsulBackend::getCurrentEndpoint()
+{
+  std::lock_guard<std::mutex> lock(mConnectionMutex);
+  return mCurrentEndpoint;
+}
+
+template <typename Result>
+Result ConsulBackend::request(const std::function<Result(ppconsul::kv::Kv&)>& call)
 {
+  std::unique_ptr<Connection> connection;
+  {
+    std::lock_guard<std::mutex> lock(mConnectionMutex);
+    if (!mIdleConnections.empty()) {
+      connection = std::move(mIdleConnections.back());
+      mIdleConnections.pop_back();
+    }
+  }
+  if (!connection) {
+    connection = connect(getCurrentEndpoint());
+  }
+  // The connection is kept for the next request, also when this one failed
+  ScopeExit release([this, &connection]() {
+    std::lock_guard<std::mutex> lock(mConnectionMutex);
+    mIdleConnections.push_back(std::move(connection));
+  });
+  return retry<Result>(mRetryPolicy, [this, &call, &connection](unsigned attempt) {
+    if (attempt > 0 && mEndpoints.size() > 1) {
+      connection = connect((connection->endpoint + 1) % mEndpoints.size());
+      std::lock_guard<std::mutex> lock(mConnectionMutex);
+      mCurrentEndpoint = connection->endpoint;
+    }
+    return call(*connection->storage);
+  }, isTransient);
+}
+
+ConsulBackend::~ConsulBackend()
+{
+  // Destructor must not throw, call flush() explicitly to handle errors
+  try {
+    flush();
+  } catch (const std::exception& e) {
+    std::cerr << "ConsulBackend: unable to flush " << mPendingWrites.size() << " buffered writes: " << e.what() << std::endl;
+  } catch (...) {
+    std::cerr << "ConsulBackend: unable to flush " << mPendingWrites.size() << " buffered writes" << std::endl;
+  }
 }
 
 auto ConsulBackend::replaceDefaultWithSlash(const std::string& path) -> std::string
@@ -57,43 +223,698 @@ auto ConsulBackend::replaceSlashWithDefault(const std::string& path) -> std::str
 
 void ConsulBackend::putString(const std::string& path, const std::string& value)
 {
-  mStorage.set(replaceDefaultWithSlash(addPrefix(path)), value);
+  auto key = replaceDefaultWithSlash(addConsulPrefix(path));
+  if (mWriteBehind) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPendingWrites[key] = value;
+    return;
+  }
+  request<void>([&](ppconsul::kv::Kv& storage) { storage.set(key, value); });
+  std::lock_guard<std::mutex> lock(mMutex);
+  updatePrefetched(key, value);
+}
+
+void ConsulBackend::putRecursive(const std::string& path, const boost::property_tree::ptree& tree)
+{
+  auto requestKey = replaceDefaultWithSlash(addConsulPrefix(path));
+  if (!requestKey.empty() && requestKey.back() != '/') {
+    requestKey += '/';
+  }
+
+  // Only leaves hold values in Consul, array elements are stored under their position
+  std::vector<ppconsul::kv::TxnOperation> operations;
+  using boost::property_tree::ptree;
+  std::function<void(const ptree&, const std::string&)> parse = [&](const ptree& node, const std::string& key) {
+    if (node.empty()) {
+      operations.push_back(ppconsul::kv::txn_ops::Set{key, node.data(), 0});
+      return;
+    }
+    std::size_t position = 0;
+    for (auto const& it : node) {
+      auto name = it.first.empty() ? std::to_string(position) : replaceDefaultWithSlash(it.first);
+      parse(it.second, key.empty() || key.back() == '/' ? key + name : key + '/' + name);
+      position++;
+    }
+  };
+  parse(tree, requestKey);
+  commit(operations);
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (const auto& operation : operations) {
+    const auto& set = boost::get<ppconsul::kv::txn_ops::Set>(operation);
+    updatePrefetched(set.key, set.value);
+  }
+}
+
+void ConsulBackend::erase(const std::string& path)
+{
+  auto key = replaceDefaultWithSlash(addConsulPrefix(path));
+  if (mWriteBehind) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPendingWrites[key] = boost::none;
+    return;
+  }
+  request<void>([&](ppconsul::kv::Kv& storage) { storage.erase(key); });
+  std::lock_guard<std::mutex> lock(mMutex);
+  updatePrefetched(key, boost::none);
+}
+
+void ConsulBackend::flush()
+{
+  // Writes stay visible to getString() while they are committed
+  std::unique_lock<std::mutex> lock(mMutex);
+  auto writes = mPendingWrites;
+  lock.unlock();
+  if (writes.empty()) {
+    return;
+  }
+  std::vector<ppconsul::kv::TxnOperation> operations;
+  operations.reserve(writes.size());
+  for (const auto& write : writes) {
+    if (write.second) {
+      operations.push_back(ppconsul::kv::txn_ops::Set{write.first, *write.second, 0});
+    } else {
+      operations.push_back(ppconsul::kv::txn_ops::Erase{write.first});
+    }
+  }
+  commit(operations);
+  lock.lock();
+  for (const auto& write : writes) {
+    updatePrefetched(write.first, write.second);
+    // Keys written again meanwhile are left for the next flush
+    auto pending = mPendingWrites.find(write.first);
+    if (pending != mPendingWrites.end() && pending->second == write.second) {
+      mPendingWrites.erase(pending);
+    }
+  }
+}
+
+void ConsulBackend::commit(const std::vector<ppconsul::kv::TxnOperation>& operations)
+{
+  // Split operations into batches respecting the transaction limits
+  std::vector<std::vector<ppconsul::kv::TxnOperation>> batches;
+  std::size_t batchBytes = 0;
+  for (const auto& operation : operations) {
+    std::size_t bytes = 0;
+    if (auto set = boost::get<ppconsul::kv::txn_ops::Set>(&operation)) {
+      bytes = set->key.size() + set->value.size();
+    }
+    if (batches.empty() || batches.back().size() == MAX_TXN_OPERATIONS || batchBytes + bytes > MAX_TXN_BYTES) {
+      batches.emplace_back();
+      batchBytes = 0;
+    }
+    batches.back().push_back(operation);
+    batchBytes += bytes;
+  }
+  if (batches.empty()) {
+    return;
+  }
+
+  // Each worker owns a connection and commits batches until none is left, a failed batch is retried on the next endpoint
+  std::atomic<std::size_t> next{ 0 };
+  auto current = getCurrentEndpoint();
+  auto worker = [&]() {
+    auto endpoint = current;
+    auto consul = std::make_unique<ppconsul::Consul>(mEndpoints[endpoint]);
+    auto storage = std::make_unique<ppconsul::kv::Kv>(*consul);
+    for (auto i = next++; i < batches.size(); i = next++) {
+      retry<void>(mRetryPolicy, [&](unsigned attempt) {
+        if (attempt > 0 && mEndpoints.size() > 1) {
+          endpoint = (endpoint + 1) % mEndpoints.size();
+          storage.reset();
+          consul = std::make_unique<ppconsul::Consul>(mEndpoints[endpoint]);
+          storage = std::make_unique<ppconsul::kv::Kv>(*consul);
+        }
+        storage->commit(batches[i]);
+      }, isTransient);
+    }
+  };
+  std::vector<std::future<void>> workers;
+  for (std::size_t i = 0; i < std::min(MAX_TXN_IN_FLIGHT, batches.size()); i++) {
+    workers.push_back(std::async(std::launch::async, worker));
+  }
+  for (auto& future : workers) {
+    future.get();
+  }
 }
 
 boost::optional<std::string> ConsulBackend::getString(const std::string& path)
 {
-  auto item = mStorage.item(replaceDefaultWithSlash(addConsulPrefix(path)),
-      ppconsul::kw::consistency = ppconsul::Consistency::Stale);
-  if (item.valid()) {
-    return std::move(item.value);
-  } else {
-    return {};
+  auto lookup = measureFirstLookup();
+  auto key = replaceDefaultWithSlash(addConsulPrefix(path));
+  bool listed = true;
+  if (mKeyFilter) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    listed = mKnownKeysIndex != 0;
+  }
+  if (!listed) {
+    listKnownKeys();
+  }
+  std::unique_lock<std::mutex> lock(mMutex);
+  auto pending = mPendingWrites.find(key);
+  if (pending != mPendingWrites.end()) {
+    return pending->second;
+  }
+  collectPrefetched();
+  auto prefetched = mPrefetched.find(key);
+  if (prefetched != mPrefetched.end()) {
+    return prefetched->second;
+  }
+  for (const auto& prefix : mPrefetchedPrefixes) {
+    if (isUnderPrefix(key, prefix)) {
+      return {};
+    }
   }
+  if (mKeyFilter) {
+    auto basePrefix = replaceDefaultWithSlash(mBasePrefix);
+    if (key.compare(0, basePrefix.size(), basePrefix) == 0 && !std::binary_search(mKnownKeys.begin(), mKnownKeys.end(), key)) {
+      return {};
+    }
+  }
+
+  // Concurrent reads of the same key wait for a single request
+  lock.unlock();
+  auto fetch = [this, key]() {
+    return mItemRequests.run(key, [this, &key]() -> boost::optional<std::string> {
+      auto item = request<ppconsul::kv::KeyValue>([&key](ppconsul::kv::Kv& storage) {
+        return storage.item(key, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+      });
+      if (item.valid()) {
+        return std::move(item.value);
+      } else {
+        return {};
+      }
+    });
+  };
+  return mItemCache.isEnabled() ? mItemCache.get(key, fetch) : fetch();
+}
+
+uint64_t ConsulBackend::getIndex(const std::string& path)
+{
+  auto key = replaceDefaultWithSlash(addConsulPrefix(path));
+  auto keys = request<ppconsul::Response<std::vector<std::string>>>([&key](ppconsul::kv::Kv& storage) {
+    return storage.keys(ppconsul::withHeaders, key, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+  });
+  return keys.headers().index();
 }
 
 boost::property_tree::ptree ConsulBackend::getRecursive(const std::string& path)
 {
+  auto lookup = measureFirstLookup();
   auto requestKey = replaceDefaultWithSlash(addConsulPrefix(path));
-  auto items = mStorage.items(requestKey, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
-  boost::property_tree::ptree tree;
-  for (const auto& item : items) {
-    tree.put(replaceSlashWithDefault(stripRequestKey(requestKey, item.key)), std::move(item.value));
+  auto fetch = [this, requestKey]() {
+    return mTreeRequests.run(requestKey, [this, &requestKey]() {
+      if (auto cached = findCachedPrefix(requestKey)) {
+        std::lock_guard<std::mutex> lock(cached->mutex);
+        read(requestKey, *cached, true);
+        return *cached->tree;
+      }
+      boost::property_tree::ptree tree;
+      readPrefix(requestKey, [&](std::vector<ppconsul::kv::KeyValue>& items) {
+        for (auto& item : items) {
+          tree.put(replaceSlashWithDefault(stripRequestKey(requestKey, item.key)), std::move(item.value));
+        }
+      });
+      return tree;
+    });
+  };
+  return mTreeCache.isEnabled() ? mTreeCache.get(requestKey, fetch) : fetch();
+}
+
+KeyValueMap ConsulBackend::getMatching(const std::string& pattern)
+{
+  PathPattern matcher(pattern, getSeparator());
+  auto base = replaceDefaultWithSlash(addConsulPrefix(""));
+  auto requestKey = base + replaceDefaultWithSlash(matcher.getLiteralPrefix());
+
+  // Keys under the literal prefix are listed, values are read for matching keys only
+  auto keys = request<std::vector<std::string>>([&requestKey](ppconsul::kv::Kv& storage) {
+    return storage.keys(requestKey, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+  });
+  auto pageSize = mPageSize == 0 ? MAX_TXN_OPERATIONS : std::min(mPageSize, MAX_TXN_OPERATIONS);
+  std::vector<std::vector<ppconsul::kv::TxnOperation>> pages;
+  for (auto& key : keys) {
+    // Folders hold no values, as in getRecursiveMap()
+    if (key.size() <= base.size() || key.back() == '/' || !matcher.matches(replaceSlashWithDefault(key.substr(base.size())))) {
+      continue;
+    }
+    if (pages.empty() || pages.back().size() == pageSize) {
+      pages.emplace_back();
+    }
+    pages.back().push_back(ppconsul::kv::txn_ops::Get{ std::move(key) });
+  }
+
+  KeyValueMap map;
+  for (const auto& page : pages) {
+    for (auto& item : fetchPage(page)) {
+      if (!item.value.empty()) {
+        map.emplace(replaceSlashWithDefault(item.key.substr(base.size())), std::move(item.value));
+      }
+    }
+  }
+  return map;
+}
+
+std::vector<std::string> ConsulBackend::listKeys(const std::string& path, bool recursive)
+{
+  auto requestKey = replaceDefaultWithSlash(addConsulPrefix(path));
+  if (!requestKey.empty() && requestKey.back() != '/') {
+    requestKey += '/';
+  }
+
+  auto listed = request<std::vector<std::string>>([&requestKey, recursive](ppconsul::kv::Kv& storage) {
+    // With a separator, Consul lists folders once, as their name followed by the separator
+    return recursive ? storage.keys(requestKey, ppconsul::kw::consistency = ppconsul::Consistency::Stale)
+                     : storage.subKeys(requestKey, '/', ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+  });
+  std::sort(listed.begin(), listed.end());
+  std::vector<std::string> keys;
+  for (auto& key : listed) {
+    if (recursive) {
+      // Folders are also stored as keys ending with a slash, and a key with keys under it is no leaf
+      auto child = std::lower_bound(listed.begin(), listed.end(), key + '/');
+      if (key.back() == '/' || (child != listed.end() && child->compare(0, key.size() + 1, key + '/') == 0)) {
+        continue;
+      }
+    }
+    auto name = key.substr(requestKey.size());
+    if (!name.empty() && name.back() == '/') {
+      name.pop_back();
+    }
+    if (!name.empty()) {
+      keys.push_back(replaceSlashWithDefault(name));
+    }
   }
-  return tree;
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
 }
 
 KeyValueMap ConsulBackend::getRecursiveMap(const std::string& path)
 {
+  auto map = getRecursiveMapShared(path);
+  // A map read for this call only is not referenced elsewhere and is moved out rather than copied
+  if (map.use_count() == 1) {
+    return std::move(const_cast<KeyValueMap&>(*map));
+  }
+  return *map;
+}
+
+std::shared_ptr<const KeyValueMap> ConsulBackend::getRecursiveMapShared(const std::string& path)
+{
+  auto lookup = measureFirstLookup();
   auto requestKey = replaceDefaultWithSlash(addConsulPrefix(path));
-  auto items = mStorage.items(requestKey, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
-  KeyValueMap map;
-  for (const auto& item : items) {
-    if (item.value.size() == 0) {
+  auto fetch = [this, requestKey]() {
+    return mMapRequests.run(requestKey, [this, &requestKey]() -> std::shared_ptr<const KeyValueMap> {
+      if (auto cached = findCachedPrefix(requestKey)) {
+        std::lock_guard<std::mutex> lock(cached->mutex);
+        read(requestKey, *cached, false);
+        return cached->map;
+      }
+      auto map = std::make_shared<KeyValueMap>();
+      readPrefix(requestKey, [&](std::vector<ppconsul::kv::KeyValue>& items) {
+        for (auto& item : items) {
+          // Folders hold no values
+          if (!item.value.empty()) {
+            (*map)[replaceSlashWithDefault(stripRequestKey(requestKey, item.key))] = std::move(item.value);
+          }
+        }
+      });
+      return map;
+    });
+  };
+  return mMapCache.isEnabled() ? mMapCache.get(requestKey, fetch) : fetch();
+}
+
+void ConsulBackend::setStaleTtl(std::chrono::milliseconds soft, std::chrono::milliseconds hard)
+{
+  mItemCache.setTtl(soft, hard);
+  mTreeCache.setTtl(soft, hard);
+  mMapCache.setTtl(soft, hard);
+}
+
+bool ConsulBackend::isHealthy()
+{
+  return mItemCache.isHealthy() && mTreeCache.isHealthy() && mMapCache.isHealthy();
+}
+
+MemoryUsage ConsulBackend::memoryUsage()
+{
+  // Only what the members allocate is counted, they are part of the backend object
+  auto allocated = [](const auto& member) { return footprint(member) - sizeof(member); };
+  MemoryUsage usage;
+  std::vector<std::pair<std::string, std::shared_ptr<CachedPrefix>>> prefixes;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    usage.structure = allocated(mKnownKeys);
+    usage.caches += allocated(mPrefetched) + allocated(mPendingWrites);
+    prefixes.assign(mCache.begin(), mCache.end());
+  }
+  // A prefix being updated is waited for without blocking other calls
+  for (const auto& cached : prefixes) {
+    auto& prefix = *cached.second;
+    std::lock_guard<std::mutex> lock(prefix.mutex);
+    usage.caches += 4 * sizeof(void*) + footprint(cached.first) + sizeof(prefix) + allocated(prefix.modifyIndexes)
+                    + (prefix.tree ? allocated(*prefix.tree) : 0) + (prefix.map ? footprint(*prefix.map) : 0);
+  }
+  usage.caches += mItemCache.getFootprint() + mTreeCache.getFootprint() + mMapCache.getFootprint();
+  return usage;
+}
+
+SingleFlightStatistics ConsulBackend::getRequestStatistics()
+{
+  SingleFlightStatistics statistics;
+  for (const auto& flight : { mItemRequests.getStatistics(), mTreeRequests.getStatistics(), mMapRequests.getStatistics() }) {
+    statistics.requests += flight.requests;
+    statistics.coalesced += flight.coalesced;
+  }
+  return statistics;
+}
+
+void ConsulBackend::prefetch(const std::vector<std::string>& paths, std::chrono::milliseconds timeout)
+{
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  std::vector<std::string> requestKeys;
+  for (const auto& path : paths) {
+    requestKeys.push_back(replaceDefaultWithSlash(addConsulPrefix(path)));
+  }
+  auto endpoints = mEndpoints;
+  auto current = getCurrentEndpoint();
+  // Each request uses its own connection, as the requests run in parallel
+  mPrefetcher.start(requestKeys, [endpoints, current, policy = mRetryPolicy](const std::string& requestKey) {
+    using Items = std::vector<ppconsul::kv::KeyValue>;
+    return retry<Items>(policy, [&](unsigned attempt) {
+      ppconsul::Consul consul(endpoints[(current + attempt) % endpoints.size()]);
+      ppconsul::kv::Kv storage(consul);
+      return storage.items(requestKey, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+    }, isTransient);
+  }, MAX_PREFETCH_IN_FLIGHT);
+  mPrefetcher.wait(deadline);
+  std::lock_guard<std::mutex> lock(mMutex);
+  collectPrefetched();
+}
+
+void ConsulBackend::collectPrefetched()
+{
+  for (auto& result : mPrefetcher.collect()) {
+    for (auto& item : result.second) {
+      mPrefetched[item.key] = std::move(item.value);
+    }
+    mPrefetchedPrefixes.push_back(result.first);
+  }
+}
+
+void ConsulBackend::updatePrefetched(const std::string& key, const boost::optional<std::string>& value)
+{
+  mItemCache.invalidate(key);
+  mTreeCache.invalidate(key);
+  mMapCache.invalidate(key);
+  for (auto& cached : mCache) {
+    if (isUnderPrefix(key, cached.first)) {
+      cached.second->written = true;
+    }
+  }
+  if (mKnownKeysIndex != 0) {
+    mKnownKeysWrites++;
+    auto position = std::lower_bound(mKnownKeys.begin(), mKnownKeys.end(), key);
+    auto known = position != mKnownKeys.end() && *position == key;
+    if (value && !known) {
+      mKnownKeys.insert(position, key);
+    } else if (!value && known) {
+      mKnownKeys.erase(position);
+    }
+  }
+
+  if (!value) {
+    mPrefetched.erase(key);
+    return;
+  }
+  for (const auto& prefix : mPrefetchedPrefixes) {
+    if (isUnderPrefix(key, prefix)) {
+      mPrefetched[key] = *value;
+      return;
+    }
+  }
+  // Keys outside of prefetched prefixes are read from Consul
+  mPrefetched.erase(key);
+}
+
+void ConsulBackend::listKnownKeys()
+{
+  // Threads needing the listing wait for the one making it, without blocking other calls
+  std::lock_guard<std::mutex> listing(mKnownKeysMutex);
+  std::unique_lock<std::mutex> lock(mMutex);
+  auto index = mKnownKeysIndex;
+  lock.unlock();
+  using Keys = ppconsul::Response<std::vector<std::string>>;
+  for (;;) {
+    lock.lock();
+    auto writes = mKnownKeysWrites;
+    lock.unlock();
+    auto keys = request<Keys>([this](ppconsul::kv::Kv& storage) {
+      return storage.keys(ppconsul::withHeaders, replaceDefaultWithSlash(mBasePrefix),
+                          ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+    });
+    lock.lock();
+    if (keys.headers().index() == index) {
+      return;
+    }
+    if (mKnownKeysWrites != writes) {
+      // A write of this instance may be missing in the listing
+      lock.unlock();
       continue;
     }
-    map[replaceSlashWithDefault(stripRequestKey(requestKey, item.key))] = std::move(item.value);
+    mKnownKeys = std::move(keys.value());
+    std::sort(mKnownKeys.begin(), mKnownKeys.end());
+    mKnownKeysIndex = keys.headers().index();
+    return;
   }
-  return map;
+}
+
+void ConsulBackend::refresh()
+{
+  std::vector<std::pair<std::string, std::shared_ptr<CachedPrefix>>> prefixes;
+  bool listed;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    // Prefetched values are not tracked, they are read again from Consul
+    collectPrefetched();
+    mPrefetched.clear();
+    mPrefetchedPrefixes.clear();
+    listed = mKnownKeysIndex != 0;
+    prefixes.assign(mCache.begin(), mCache.end());
+  }
+  if (listed) {
+    listKnownKeys();
+  }
+  // Each prefix is updated under its own lock, also when dropped meanwhile
+  for (const auto& cached : prefixes) {
+    std::lock_guard<std::mutex> lock(cached.second->mutex);
+    cached.second->written = false;
+    update(cached.first, *cached.second);
+  }
+}
+
+void ConsulBackend::keepPrefix(const std::string& path)
+{
+  auto requestKey = replaceDefaultWithSlash(addConsulPrefix(path));
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto& cached = mCache[requestKey];
+  if (!cached) {
+    cached = std::make_shared<CachedPrefix>();
+  }
+}
+
+void ConsulBackend::dropPrefix(const std::string& path)
+{
+  auto requestKey = replaceDefaultWithSlash(addConsulPrefix(path));
+  std::lock_guard<std::mutex> lock(mMutex);
+  mCache.erase(requestKey);
+}
+
+auto ConsulBackend::findCachedPrefix(const std::string& requestKey) -> std::shared_ptr<CachedPrefix>
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto cached = mCache.find(requestKey);
+  return cached == mCache.end() ? nullptr : cached->second;
+}
+
+void ConsulBackend::read(const std::string& requestKey, CachedPrefix& cached, bool tree)
+{
+  if (tree ? !cached.tree : !cached.map) {
+    // Both forms are filled from a new download, the one kept so far starts over too
+    cached.index = 0;
+    cached.modifyIndexes.clear();
+    if (tree || cached.tree) {
+      cached.tree.emplace();
+    }
+    if (!tree || cached.map) {
+      cached.map = std::make_shared<KeyValueMap>();
+    }
+  }
+  if (cached.index == 0 || cached.written.exchange(false)) {
+    try {
+      update(requestKey, cached);
+    } catch (...) {
+      cached.written = true;
+      throw;
+    }
+  }
+}
+
+void ConsulBackend::update(const std::string& requestKey, CachedPrefix& cached)
+{
+  if (!cached.tree && !cached.map) {
+    return;
+  }
+
+  // Listing keys is enough to learn the index of the prefix, values are downloaded only if it moved
+  uint64_t index = 0;
+  std::vector<std::string> keys;
+  if (cached.index != 0 || mPageSize != 0) {
+    auto listing = request<ppconsul::Response<std::vector<std::string>>>([&requestKey](ppconsul::kv::Kv& storage) {
+      return storage.keys(ppconsul::withHeaders, requestKey, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+    });
+    if (listing.headers().index() == cached.index) {
+      return;
+    }
+    index = listing.headers().index();
+    keys = std::move(listing.value());
+  }
+
+  // Maps handed out by getRecursiveMapShared() stay as they are
+  if (cached.map && cached.map.use_count() > 1) {
+    cached.map = std::make_shared<KeyValueMap>(*cached.map);
+  }
+  std::unordered_map<std::string, uint64_t> modifyIndexes;
+  auto apply = [&](std::vector<ppconsul::kv::KeyValue>& items) {
+    for (auto& item : items) {
+      auto previous = cached.modifyIndexes.find(item.key);
+      modifyIndexes.emplace(item.key, item.modifyIndex);
+      if (previous != cached.modifyIndexes.end() && previous->second == item.modifyIndex) {
+        continue;
+      }
+      auto key = replaceSlashWithDefault(stripRequestKey(requestKey, item.key));
+      if (cached.tree) {
+        cached.tree->put(key, item.value);
+      }
+      if (!cached.map) {
+        continue;
+      }
+      if (item.value.size() == 0) {
+        cached.map->erase(key);
+      } else {
+        (*cached.map)[key] = std::move(item.value);
+      }
+    }
+  };
+  if (mPageSize != 0) {
+    // Values newer than the listing only cause another download at the next update
+    std::sort(keys.begin(), keys.end());
+    for (const auto& page : planPages(keys, requestKey, mPageSize)) {
+      auto items = fetchPage(page);
+      apply(items);
+    }
+  } else {
+    auto items = request<ppconsul::Response<std::vector<ppconsul::kv::KeyValue>>>([&requestKey](ppconsul::kv::Kv& storage) {
+      return storage.items(ppconsul::withHeaders, requestKey, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+    });
+    apply(items.value());
+    index = items.headers().index();
+  }
+
+  // Drop keys removed from Consul
+  for (const auto& previous : cached.modifyIndexes) {
+    if (modifyIndexes.count(previous.first)) {
+      continue;
+    }
+    auto key = replaceSlashWithDefault(stripRequestKey(requestKey, previous.first));
+    if (cached.map) {
+      cached.map->erase(key);
+    }
+    if (!cached.tree) {
+      continue;
+    }
+    auto separator = key.rfind(getSeparator());
+    auto parent = cached.tree->get_child_optional(separator == std::string::npos ? "" : key.substr(0, separator));
+    auto name = separator == std::string::npos ? key : key.substr(separator + 1);
+    auto node = parent ? parent->find(name) : cached.tree->not_found();
+    if (parent && node != parent->not_found()) {
+      // Keep children of a key which also is a folder
+      if (node->second.empty()) {
+        parent->erase(parent->to_iterator(node));
+      } else {
+        node->second.data().clear();
+      }
+    }
+  }
+  cached.modifyIndexes = std::move(modifyIndexes);
+  cached.index = index;
+}
+
+std::vector<ppconsul::kv::KeyValue> ConsulBackend::fetchPage(const std::vector<ppconsul::kv::TxnOperation>& page)
+{
+  try {
+    return request<std::vector<ppconsul::kv::KeyValue>>([&page](ppconsul::kv::Kv& storage) {
+      return storage.commit(page);
+    });
+  } catch (const ppconsul::kv::TxnAborted&) {
+    // A key removed since it was listed aborts the whole transaction, its reads are then made one by one
+    std::vector<ppconsul::kv::KeyValue> items;
+    for (const auto& operation : page) {
+      if (auto get = boost::get<ppconsul::kv::txn_ops::Get>(&operation)) {
+        auto item = request<ppconsul::kv::KeyValue>([get](ppconsul::kv::Kv& storage) {
+          return storage.item(get->key, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+        });
+        if (item.valid()) {
+          items.push_back(std::move(item));
+        }
+      } else {
+        const auto& prefix = boost::get<ppconsul::kv::txn_ops::GetAll>(operation).keyPrefix;
+        auto folder = request<std::vector<ppconsul::kv::KeyValue>>([&prefix](ppconsul::kv::Kv& storage) {
+          return storage.items(prefix, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+        });
+        std::move(folder.begin(), folder.end(), std::back_inserter(items));
+      }
+    }
+    return items;
+  }
+}
+
+void ConsulBackend::readPrefix(const std::string& requestKey,
+                               const std::function<void(std::vector<ppconsul::kv::KeyValue>&)>& consume)
+{
+  if (mPageSize == 0) {
+    auto items = request<std::vector<ppconsul::kv::KeyValue>>([&requestKey](ppconsul::kv::Kv& storage) {
+      return storage.items(requestKey, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+    });
+    consume(items);
+    return;
+  }
+  auto keys = request<std::vector<std::string>>([&requestKey](ppconsul::kv::Kv& storage) {
+    return storage.keys(requestKey, ppconsul::kw::consistency = ppconsul::Consistency::Stale);
+  });
+  std::sort(keys.begin(), keys.end());
+  for (const auto& page : planPages(keys, requestKey, mPageSize)) {
+    auto items = fetchPage(page);
+    consume(items);
+  }
+}
+
+void ConsulBackend::getRecursivePages(const std::string& path, const std::function<void(KeyValueMap&)>& consume)
+{
+  auto requestKey = replaceDefaultWithSlash(addConsulPrefix(path));
+  readPrefix(requestKey, [&](std::vector<ppconsul::kv::KeyValue>& items) {
+    KeyValueMap map;
+    for (auto& item : items) {
+      // Folders hold no values, as in getRecursiveMap()
+      if (!item.value.empty()) {
+        map.emplace(replaceSlashWithDefault(stripRequestKey(requestKey, item.key)), std::move(item.value));
+      }
+    }
+    // Values of the page are released before the next one is read
+    items = std::vector<ppconsul::kv::KeyValue>();
+    consume(map);
+  });
 }
 
 } // namespace backends
@@ -19,8 +19,20 @@
 #define O2_CONFIGURATION_BACKENDS_CONSULBACKEND_H_
 
 #include "../BackendBase.h"
+#include "../Prefetcher.h"
+#include "../Retry.h"
+#include "../SingleFlight.h"
+#include "../StaleCache.h"
 #include <ppconsul/kv.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace o2
 {
@@ -36,19 +48,200 @@ class ConsulBackend final : public BackendBase
     /// Connects to Consul backend
     ConsulBackend(const std::string& host, int port);
 
-    /// Default destructor
-    virtual ~ConsulBackend() = default;
+    /// Writes out values still held in the write-behind buffer, failures are only reported on stderr
+    virtual ~ConsulBackend();
     virtual void putString(const std::string& path, const std::string& value) override;
+
+    /// Writes the tree in several independent transactions, a failure may leave it partially written
+    virtual void putRecursive(const std::string& path, const boost::property_tree::ptree& tree) override;
+    virtual void erase(const std::string& path) override;
+
+    /// Writes buffered values in several independent transactions, a failure may leave them partially written
+    virtual void flush() override;
     virtual boost::optional<std::string> getString(const std::string& path) override;
     virtual KeyValueMap getRecursiveMap(const std::string&) override;
+
+    /// Shares the map of a kept prefix until the prefix changes in Consul
+    virtual std::shared_ptr<const KeyValueMap> getRecursiveMapShared(const std::string& path) override;
     virtual boost::property_tree::ptree getRecursive(const std::string& path) override;
 
+    /// Lists keys under the literal prefix of the pattern, then reads values of matching keys only, in transactions
+    virtual KeyValueMap getMatching(const std::string& pattern) override;
+
+    /// Uses key listings of Consul, values are not downloaded
+    virtual std::vector<std::string> listKeys(const std::string& path, bool recursive) override;
+
+    /// Fetches prefixes concurrently, getString() of keys under them is then served from memory
+    virtual void prefetch(const std::vector<std::string>& paths, std::chrono::milliseconds timeout) override;
+
+    /// Patches kept prefixes with keys changed in Consul
+    /// Prefetched values are dropped, keys under prefetched prefixes are then read from Consul.
+    virtual void refresh() override;
+
+    /// Keeps the values under a path in memory once read by getRecursive() or getRecursiveMap()
+    /// Further reads of the same path are served from memory, refresh() patches them with keys changed in Consul.
+    /// Only the form read, tree or map, is kept. Other paths are read from Consul at each call.
+    /// \param path The path of the values
+    void keepPrefix(const std::string& path);
+
+    /// Releases the values kept for a path by keepPrefix()
+    /// \param path The path of the values
+    void dropPrefix(const std::string& path);
+
     void setBasePrefix(const std::string& path)
     {
       mBasePrefix = path;
     }
 
+    /// Enables or disables buffering of putString() and erase() calls until flush() is called
+    /// Buffered values are visible to getString() of this instance before being flushed.
+    void setWriteBehind(bool enabled)
+    {
+      mWriteBehind = enabled;
+    }
+
+    /// Enables answering getString() of keys missing in Consul without a request
+    /// Keys under the base prefix are listed once, the list is updated by refresh() and by writes of this instance.
+    void setKeyFilter(bool enabled)
+    {
+      mKeyFilter = enabled;
+    }
+
+    /// Limits the number of keys read by a single request of a prefix
+    /// Prefixes are then listed first and read in pages of whole folders, or of single keys of larger folders.
+    /// Besides the result, only one page is held in memory, unless the prefix is kept by keepPrefix().
+    /// \param keys Maximum number of keys per request, zero to read prefixes in a single request
+    void setPageSize(std::size_t keys)
+    {
+      mPageSize = keys;
+    }
+
+    /// Reads key-values under a path page by page, only one page is held in memory at a time
+    /// Values are not cached, pages of concurrent changes to the prefix may be inconsistent with each other.
+    /// \param path The path of the values
+    /// \param consume Called with each page of key-values, relative to the path
+    void getRecursivePages(const std::string& path, const std::function<void(KeyValueMap&)>& consume);
+
+    /// Reads the Consul index of a key without downloading its value
+    /// The index moves whenever the key, or another key starting with it, changes.
+    /// \param path Path of the key
+    uint64_t getIndex(const std::string& path);
+
+    /// Adds an endpoint serving the same data, requests are retried on the next endpoint
+    void addReplica(const std::string& host, int port)
+    {
+      mEndpoints.push_back(host + ":" + std::to_string(port));
+    }
+
+    /// Sets retries of failed requests
+    void setRetryPolicy(const RetryPolicy& policy)
+    {
+      mRetryPolicy = policy;
+    }
+
+    /// Enables serving cached values at once while refreshing them in the background
+    /// \param soft Age after which a value is refreshed in the background, zero disables the cache
+    /// \param hard Age after which a value is read before returning, zero to always return the cached value
+    void setStaleTtl(std::chrono::milliseconds soft, std::chrono::milliseconds hard);
+
+    /// Tells whether the last request of the stale-while-revalidate cache reached Consul
+    virtual bool isHealthy() override;
+
+    /// Cached and prefetched values as caches, the known keys as index structure
+    virtual MemoryUsage memoryUsage() override;
+
+    /// Reports requests made and requests saved by coalescing concurrent identical ones
+    SingleFlightStatistics getRequestStatistics();
+
   private:
+    /// Connection to an endpoint, used by one request at a time
+    struct Connection {
+      /// Index of the endpoint
+      std::size_t endpoint;
+      std::unique_ptr<ppconsul::Consul> consul;
+      std::unique_ptr<ppconsul::kv::Kv> storage;
+    };
+
+    /// Content of a prefix kept by keepPrefix()
+    struct CachedPrefix {
+      /// Guards the content while it is read or updated, without blocking other prefixes
+      std::mutex mutex;
+
+      /// X-Consul-Index of the last read, 0 until read
+      uint64_t index = 0;
+
+      /// Set by writes of this instance under the prefix, the next read updates the content
+      std::atomic<bool> written{ false };
+
+      /// ModifyIndex of each key, by full Consul key
+      std::unordered_map<std::string, uint64_t> modifyIndexes;
+
+      /// Values as returned by getRecursive(), only once read in this form
+      boost::optional<boost::property_tree::ptree> tree;
+
+      /// Values as returned by getRecursiveMap(), only once read in this form; copied before patching while shared
+      std::shared_ptr<KeyValueMap> map;
+    };
+
+    /// Returns the cache entry of a kept prefix
+    /// \param requestKey Full Consul key of the prefix
+    /// \return The entry, nullptr when the prefix is not kept
+    std::shared_ptr<CachedPrefix> findCachedPrefix(const std::string& requestKey);
+
+    /// Reads a kept prefix in the form of a tree or of a map, unless it was read in this form already
+    /// Values are read again from Consul when the prefix was kept in the other form only.
+    /// Must be called with the mutex of the cached content locked.
+    /// \param requestKey Full Consul key of the prefix
+    /// \param cached Cached content of the prefix
+    /// \param tree Whether the tree form is needed, otherwise the map form
+    void read(const std::string& requestKey, CachedPrefix& cached, bool tree);
+
+    /// Checks whether a prefix changed and patches the cached content with changed keys only
+    /// Must be called with the mutex of the cached content locked.
+    /// \param requestKey Full Consul key of the prefix
+    /// \param cached Cached content of the prefix
+    void update(const std::string& requestKey, CachedPrefix& cached);
+
+    /// Reads all values under a prefix, in pages when a page size is set
+    /// \param requestKey Full Consul key of the prefix
+    /// \param consume Called with the values of each page, or once with all values
+    void readPrefix(const std::string& requestKey, const std::function<void(std::vector<ppconsul::kv::KeyValue>&)>& consume);
+
+    /// Moves results of finished prefetch requests into the prefetched values
+    void collectPrefetched();
+
+    /// Updates a prefetched value, the known keys and cached values after it was written
+    /// \param key Full Consul key
+    /// \param value New value, empty when the key was erased
+    void updatePrefetched(const std::string& key, const boost::optional<std::string>& value);
+
+    /// Reads the keys of a page in a single transaction, or one operation after another when it is aborted
+    /// \param page Operations reading keys and folders
+    std::vector<ppconsul::kv::KeyValue> fetchPage(const std::vector<ppconsul::kv::TxnOperation>& page);
+
+    /// Lists keys under the base prefix into the known keys, unless they did not change since the last listing
+    /// Must be called without holding mMutex.
+    void listKnownKeys();
+
+    /// Connects to an endpoint
+    /// \param endpoint Index of the endpoint
+    std::unique_ptr<Connection> connect(std::size_t endpoint);
+
+    /// Index of the endpoint new connections are made to
+    std::size_t getCurrentEndpoint();
+
+    /// Runs a request on an idle connection, retrying failures on the next endpoint
+    /// Requests do not need mMutex, concurrent requests use separate connections.
+    /// \param call Makes the request
+    template <typename Result>
+    Result request(const std::function<Result(ppconsul::kv::Kv&)>& call);
+
+    /// Commits operations to Consul as transactions
+    /// Operations are split into batches that fit a single Consul transaction,
+    /// and several batches are sent concurrently.
+    /// \param operations Operations to commit
+    void commit(const std::vector<ppconsul::kv::TxnOperation>& operations);
+
     /// Prepends path with the consul and current prefix
     /// A full consul key is needed by the ppconsul invocation
     /// \param path A path
@@ -68,14 +261,80 @@ class ConsulBackend final : public BackendBase
     /// \return A path with DEFAULT_SEPARATOR
     std::string replaceSlashWithDefault(const std::string& path);
 
-    /// Consul endpoint
-    ppconsul::Consul mConsul;
+    /// Consul endpoint addresses, the first one is used until a request fails
+    std::vector<std::string> mEndpoints;
+
+    /// Index of the endpoint new connections are made to, moves to the next endpoint when a request fails
+    std::size_t mCurrentEndpoint = 0;
 
-    /// Key-value object
-    ppconsul::kv::Kv mStorage;
+    /// Connections not used by any request
+    std::vector<std::unique_ptr<Connection>> mIdleConnections;
+
+    /// Guards the idle connections and the current endpoint
+    std::mutex mConnectionMutex;
+
+    /// Retries of failed requests
+    RetryPolicy mRetryPolicy;
 
     /// Base Consul key
     std::string mBasePrefix;
+
+    /// Whether putString() calls are buffered
+    bool mWriteBehind = false;
+
+    /// Maximum number of keys read by one request of a prefix, zero for no limit
+    std::size_t mPageSize = 0;
+
+    /// Whether getString() of keys missing in mKnownKeys is answered without a request
+    bool mKeyFilter = false;
+
+    /// Keys under the base prefix, sorted, as full Consul keys
+    std::vector<std::string> mKnownKeys;
+
+    /// X-Consul-Index of the listing of known keys, 0 until listed
+    uint64_t mKnownKeysIndex = 0;
+
+    /// Number of writes of this instance which updated the known keys, a listing running meanwhile is repeated
+    uint64_t mKnownKeysWrites = 0;
+
+    /// Lets one thread at a time list the known keys
+    std::mutex mKnownKeysMutex;
+
+    /// Prefixes kept in memory, by full Consul key
+    std::map<std::string, std::shared_ptr<CachedPrefix>> mCache;
+
+    /// Prefetched values, by full Consul key
+    std::unordered_map<std::string, std::string> mPrefetched;
+
+    /// Prefetched prefixes, keys starting with them and missing in mPrefetched do not exist
+    std::vector<std::string> mPrefetchedPrefixes;
+
+    /// Values waiting to be flushed, by full Consul key; empty when the key is erased
+    std::map<std::string, boost::optional<std::string>> mPendingWrites;
+
+    /// Guards the entries of the cache, prefetched values, pending writes and known keys; not held during requests
+    std::mutex mMutex;
+
+    /// Coalesces concurrent getString() requests of the same key
+    SingleFlight<boost::optional<std::string>> mItemRequests;
+
+    /// Coalesces concurrent getRecursive() requests of the same prefix
+    SingleFlight<boost::property_tree::ptree> mTreeRequests;
+
+    /// Coalesces concurrent getRecursiveMap() and getRecursiveMapShared() requests of the same prefix
+    SingleFlight<std::shared_ptr<const KeyValueMap>> mMapRequests;
+
+    /// Stale-while-revalidate cache of getString(), by full Consul key
+    StaleCache<boost::optional<std::string>> mItemCache;
+
+    /// Stale-while-revalidate cache of getRecursive(), by full Consul key of the prefix
+    StaleCache<boost::property_tree::ptree> mTreeCache;
+
+    /// Stale-while-revalidate cache of getRecursiveMap() and getRecursiveMapShared(), by full Consul key of the prefix
+    StaleCache<std::shared_ptr<const KeyValueMap>> mMapCache;
+
+    /// Prefetch requests, kept last so that running requests finish before other members are destroyed
+    Prefetcher<std::vector<ppconsul::kv::KeyValue>> mPrefetcher;
 };
 
 } // namespace backends
@@ -0,0 +1,152 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file ConsulBlobBackend.cxx
+/// \brief Configuration interface to JSON or INI data stored in a single Consul value
+///
+
+#include "ConsulBlobBackend.h"
+#include "../Ini/IniBackend.h"
+#include "../Json/JsonParallelParser.h"
+#include "../PhaseProfiler.h"
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <boost/property_tree/exceptions.hpp>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+namespace
+{
+
+/// Values parsed from a Consul value
+struct ParsedBlob {
+  /// Consul index of the parsed value
+  uint64_t index;
+
+  /// Released with the last instance using it
+  std::weak_ptr<const InternedTree> tree;
+};
+
+/// Values parsed by instances alive in the process, by endpoint, key and format
+std::unordered_map<std::string, ParsedBlob> parsedBlobs;
+
+/// Returns the values parsed from a Consul value at an index, dropping values no longer used by any instance
+/// The mutex of the parsed values must be held.
+std::shared_ptr<const InternedTree> findParsedBlob(const std::string& cacheKey, uint64_t index)
+{
+  std::shared_ptr<const InternedTree> found;
+  for (auto parsed = parsedBlobs.begin(); parsed != parsedBlobs.end();) {
+    auto tree = parsed->second.tree.lock();
+    if (!tree) {
+      parsed = parsedBlobs.erase(parsed);
+      continue;
+    }
+    if (parsed->first == cacheKey && parsed->second.index == index) {
+      found = std::move(tree);
+    }
+    ++parsed;
+  }
+  return found;
+}
+
+/// Guards the parsed values
+std::mutex parsedBlobsMutex;
+
+} // Anonymous namespace
+
+ConsulBlobBackend::ConsulBlobBackend(const std::string& host, int port, const std::string& key, Format format,
+                                     std::pmr::memory_resource* resource)
+  : TreeBackend(resource),
+    mConsul(host, port),
+    mKey(key),
+    mFormat(format),
+    mCacheKey(host + ":" + std::to_string(port) + "/" + key + (format == Format::Json ? ".json" : ".ini")),
+    mShared(resource == std::pmr::get_default_resource())
+{
+  reload();
+}
+
+void ConsulBlobBackend::putString(const std::string& /*path*/, const std::string& /*value*/)
+{
+  throw std::runtime_error("ConsulBlobBackend does not support putting values");
+}
+
+bool ConsulBlobBackend::reload()
+{
+  // Listing the key gives its index without downloading the value
+  uint64_t index;
+  {
+    auto transfer = PhaseProfiler::measure("transfer");
+    index = mConsul.getIndex(mKey);
+  }
+  if (mIndex != 0 && index == mIndex) {
+    return false;
+  }
+  if (mShared) {
+    std::lock_guard<std::mutex> lock(parsedBlobsMutex);
+    auto parsed = findParsedBlob(mCacheKey, index);
+    if (parsed) {
+      setTree(std::move(parsed));
+      mIndex = index;
+      return true;
+    }
+  }
+
+  std::string data;
+  {
+    auto transfer = PhaseProfiler::measure("transfer");
+    data = mConsul.get<std::string>(mKey);
+  }
+  boost::property_tree::ptree tree;
+  if (mFormat == Format::Json) {
+    try {
+      auto parse = PhaseProfiler::measure("parse");
+      parseJson(data.data(), data.size(), tree);
+    } catch (const boost::property_tree::ptree_error&) {
+      throw std::runtime_error("Unable to read JSON file: " + mKey);
+    }
+  } else {
+    loadConfigFile(data, tree, true);
+  }
+
+  // The value may have changed since it was listed, then the older index only causes another download later
+  if (mShared) {
+    std::shared_ptr<const InternedTree> interned;
+    {
+      auto indexing = PhaseProfiler::measure("index");
+      interned = std::make_shared<const InternedTree>(tree, std::pmr::get_default_resource());
+    }
+    {
+      std::lock_guard<std::mutex> lock(parsedBlobsMutex);
+      parsedBlobs[mCacheKey] = { index, interned };
+    }
+    setTree(std::move(interned));
+  } else {
+    setTree(tree);
+  }
+  mIndex = index;
+  return true;
+}
+
+void ConsulBlobBackend::refresh()
+{
+  reload();
+}
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
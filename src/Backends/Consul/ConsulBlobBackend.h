@@ -0,0 +1,84 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file ConsulBlobBackend.h
+/// \brief Configuration interface to JSON or INI data stored in a single Consul value
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_CONSULBLOBBACKEND_H_
+#define O2_CONFIGURATION_BACKENDS_CONSULBLOBBACKEND_H_
+
+#include "../TreeBackend.h"
+#include "ConsulBackend.h"
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Backend for JSON or INI data stored in a single Consul value
+/// Parsed values are kept while an instance uses them, by Consul endpoint and key, so that instances for an unchanged
+/// value reuse them instead of downloading and parsing the value again.
+class ConsulBlobBackend final : public TreeBackend
+{
+  public:
+    /// Format of the stored data
+    enum class Format { Json, Ini };
+
+    /// Connects to Consul and loads the value
+    /// \param host Consul host
+    /// \param port Consul port
+    /// \param key Path of the value
+    /// \param format Format of the value
+    /// \param resource Memory resource the parsed values are allocated from, values are shared between
+    ///                 instances only when it is the default resource
+    ConsulBlobBackend(const std::string& host, int port, const std::string& key, Format format,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    virtual ~ConsulBlobBackend() = default;
+    virtual void putString(const std::string& path, const std::string& value) override;
+
+    /// Loads the value again when it changed in Consul
+    /// \return Whether the values were replaced
+    bool reload();
+
+    /// Same as reload()
+    virtual void refresh() override;
+
+  private:
+    /// Connection reading the value
+    ConsulBackend mConsul;
+
+    /// Path of the value
+    std::string mKey;
+
+    Format mFormat;
+
+    /// Key of the parsed values shared by the process
+    std::string mCacheKey;
+
+    /// Whether the parsed values are shared with other instances
+    bool mShared;
+
+    /// Consul index of the loaded value, 0 until loaded
+    uint64_t mIndex = 0;
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_CONSULBLOBBACKEND_H_
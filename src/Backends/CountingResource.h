@@ -0,0 +1,83 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file CountingResource.h
+/// \brief Memory resource counting the bytes it holds
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_COUNTINGRESOURCE_H_
+#define O2_CONFIGURATION_BACKENDS_COUNTINGRESOURCE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Forwards allocations to an upstream resource and counts the bytes currently allocated through it
+class CountingResource final : public std::pmr::memory_resource
+{
+  public:
+    /// \param upstream Resource serving the allocations
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : mUpstream(upstream)
+    {
+    }
+
+    /// Bytes allocated and not deallocated yet
+    std::size_t getAllocated() const
+    {
+      return mAllocated;
+    }
+
+    /// Highest number of bytes allocated at once
+    std::size_t getPeak() const
+    {
+      return mPeak;
+    }
+
+  private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+      auto pointer = mUpstream->allocate(bytes, alignment);
+      auto allocated = mAllocated += bytes;
+      auto peak = mPeak.load();
+      while (allocated > peak && !mPeak.compare_exchange_weak(peak, allocated)) {
+      }
+      return pointer;
+    }
+
+    void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override
+    {
+      mUpstream->deallocate(pointer, bytes, alignment);
+      mAllocated -= bytes;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+      return this == &other;
+    }
+
+    std::pmr::memory_resource* mUpstream;
+    std::atomic<std::size_t> mAllocated{ 0 };
+    std::atomic<std::size_t> mPeak{ 0 };
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_COUNTINGRESOURCE_H_
@@ -0,0 +1,136 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file Decompress.cxx
+/// \brief Decompression of gzip and zstd compressed configuration data
+///
+
+#include "Decompress.h"
+#include <cstring>
+#include <stdexcept>
+
+#include <zlib.h>
+#ifdef FLP_CONFIGURATION_ZSTD_ENABLED
+# include <zstd.h>
+#endif
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+namespace
+{
+
+constexpr unsigned char GZIP_MAGIC[] = { 0x1f, 0x8b };
+constexpr unsigned char ZSTD_MAGIC[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+template <std::size_t N>
+bool hasMagic(const char* data, std::size_t size, const unsigned char (&magic)[N])
+{
+  return size >= N && std::memcmp(data, magic, N) == 0;
+}
+
+/// Size of the output buffer increments
+constexpr std::size_t CHUNK_SIZE = 256 * 1024;
+
+void inflateGzip(const char* data, std::size_t size, std::string& output)
+{
+  z_stream stream{};
+  // 16 selects the gzip header
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+    throw std::runtime_error("Unable to decompress gzip data: initialization failed");
+  }
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream.avail_in = size;
+  int status = Z_OK;
+  while (status != Z_STREAM_END) {
+    auto written = output.size();
+    output.resize(written + CHUNK_SIZE);
+    stream.next_out = reinterpret_cast<Bytef*>(&output[written]);
+    stream.avail_out = CHUNK_SIZE;
+    status = inflate(&stream, Z_NO_FLUSH);
+    output.resize(written + CHUNK_SIZE - stream.avail_out);
+    if (status == Z_STREAM_END && stream.avail_in > 0) {
+      // Continue with the next member of the file
+      inflateReset(&stream);
+      status = Z_OK;
+    } else if (status != Z_OK && status != Z_STREAM_END) {
+      std::string error = stream.msg ? stream.msg : "truncated data";
+      inflateEnd(&stream);
+      throw std::runtime_error("Unable to decompress gzip data: " + error);
+    }
+  }
+  inflateEnd(&stream);
+}
+
+#ifdef FLP_CONFIGURATION_ZSTD_ENABLED
+void decompressZstd(const char* data, std::size_t size, std::string& output)
+{
+  auto context = ZSTD_createDCtx();
+  ZSTD_inBuffer input = { data, size, 0 };
+  std::size_t remaining = 0;
+  while (input.pos < input.size) {
+    auto written = output.size();
+    output.resize(written + CHUNK_SIZE);
+    ZSTD_outBuffer buffer = { &output[written], CHUNK_SIZE, 0 };
+    remaining = ZSTD_decompressStream(context, &buffer, &input);
+    output.resize(written + buffer.pos);
+    if (ZSTD_isError(remaining)) {
+      std::string error = ZSTD_getErrorName(remaining);
+      ZSTD_freeDCtx(context);
+      throw std::runtime_error("Unable to decompress zstd data: " + error);
+    }
+  }
+  // Flush what the decoder still holds
+  while (remaining != 0) {
+    auto written = output.size();
+    output.resize(written + CHUNK_SIZE);
+    ZSTD_outBuffer buffer = { &output[written], CHUNK_SIZE, 0 };
+    remaining = ZSTD_decompressStream(context, &buffer, &input);
+    output.resize(written + buffer.pos);
+    if (ZSTD_isError(remaining) || (remaining != 0 && buffer.pos == 0)) {
+      ZSTD_freeDCtx(context);
+      throw std::runtime_error("Unable to decompress zstd data: truncated data");
+    }
+  }
+  ZSTD_freeDCtx(context);
+}
+#endif
+
+} // Anonymous namespace
+
+bool isCompressed(const char* data, std::size_t size)
+{
+  return hasMagic(data, size, GZIP_MAGIC) || hasMagic(data, size, ZSTD_MAGIC);
+}
+
+std::string decompress(const char* data, std::size_t size)
+{
+  std::string output;
+  if (hasMagic(data, size, GZIP_MAGIC)) {
+    inflateGzip(data, size, output);
+  } else if (hasMagic(data, size, ZSTD_MAGIC)) {
+#ifdef FLP_CONFIGURATION_ZSTD_ENABLED
+    decompressZstd(data, size, output);
+#else
+    throw std::runtime_error("zstd compressed data not supported, zstd was not found at build time");
+#endif
+  } else {
+    output.assign(data, size);
+  }
+  return output;
+}
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
@@ -0,0 +1,42 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file Decompress.h
+/// \brief Decompression of gzip and zstd compressed configuration data
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_DECOMPRESS_H_
+#define O2_CONFIGURATION_BACKENDS_DECOMPRESS_H_
+
+#include <cstddef>
+#include <string>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Checks magic bytes of gzip and zstd frames
+/// \return Whether data is compressed
+bool isCompressed(const char* data, std::size_t size);
+
+/// Decompresses gzip or zstd data, several concatenated frames are decompressed one after another
+/// Throws std::runtime_error when data is corrupted or support of its format is not compiled in.
+/// \return Decompressed data
+std::string decompress(const char* data, std::size_t size);
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_DECOMPRESS_H_
@@ -0,0 +1,138 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file DirectoryBackend.cxx
+/// \brief Configuration interface to a directory of JSON and INI files
+///
+
+#include "DirectoryBackend.h"
+#include "../Ini/IniParser.h"
+#include "../Json/JsonParallelParser.h"
+#include "../PhaseProfiler.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+namespace
+{
+
+/// A file to load and its parsed values
+struct File {
+  std::filesystem::path path;
+  std::string prefix;
+  boost::property_tree::ptree tree;
+  std::exception_ptr error;
+};
+
+void parse(File& file)
+{
+  try {
+    if (file.path.extension() == ".json") {
+      // Files are already parsed in parallel
+      parseJsonFile(file.path.string(), file.tree, 1);
+    } else {
+      readIniFile(file.path.string(), file.tree);
+    }
+  } catch (const boost::property_tree::ptree_error& error) {
+    file.error = std::make_exception_ptr(
+      std::runtime_error("Unable to read file: " + file.path.string() + ": " + error.what()));
+  }
+}
+
+} // Anonymous namespace
+
+DirectoryBackend::DirectoryBackend(const std::string& directory, std::pmr::memory_resource* resource)
+  : TreeBackend(resource)
+{
+  namespace fs = std::filesystem;
+  if (!fs::is_directory(directory)) {
+    throw std::runtime_error("Not a directory: " + directory);
+  }
+
+  std::vector<File> files;
+  {
+    auto listing = PhaseProfiler::measure("files");
+    for (const auto& entry : fs::recursive_directory_iterator(directory)) {
+      auto extension = entry.path().extension();
+      if (!entry.is_regular_file() || (extension != ".json" && extension != ".ini")) {
+        continue;
+      }
+      auto relative = fs::relative(entry.path(), directory).replace_extension();
+      std::string prefix;
+      for (const auto& part : relative) {
+        prefix += (prefix.empty() ? "" : std::string(1, getSeparator())) + part.string();
+      }
+      files.push_back({ entry.path(), prefix, {}, nullptr });
+    }
+    // Merge in a stable order regardless of directory listing and parsing order,
+    // a file comes before the files of its directory so that it does not replace their values
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) {
+      return a.prefix != b.prefix ? a.prefix < b.prefix : a.path < b.path;
+    });
+    // Files differing only by extension would replace each other's values
+    auto duplicate = std::adjacent_find(files.begin(), files.end(), [](const File& a, const File& b) {
+      return a.prefix == b.prefix;
+    });
+    if (duplicate != files.end()) {
+      throw std::runtime_error("Files with the same prefix: " + duplicate->path.string() + ", " + (duplicate + 1)->path.string());
+    }
+  }
+
+  {
+    // Workers read and parse the files, their own phases are not recorded
+    auto parsing = PhaseProfiler::measure("parse");
+    std::atomic<std::size_t> next(0);
+    std::vector<std::future<void>> workers;
+    auto threads = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), files.size());
+    for (std::size_t i = 0; i < threads; i++) {
+      workers.push_back(std::async(std::launch::async, [&files, &next] {
+        for (auto index = next++; index < files.size(); index = next++) {
+          parse(files[index]);
+        }
+      }));
+    }
+    // Errors not caught by parse() are passed on once all workers finished, as they use the files
+    for (auto& worker : workers) {
+      worker.wait();
+    }
+    for (auto& worker : workers) {
+      worker.get();
+    }
+  }
+
+  boost::property_tree::ptree tree;
+  for (auto& file : files) {
+    if (file.error) {
+      std::rethrow_exception(file.error);
+    }
+    tree.put_child(boost::property_tree::ptree::path_type(file.prefix, getSeparator()), {}).swap(file.tree);
+  }
+  setTree(tree);
+}
+
+void DirectoryBackend::putString(const std::string&, const std::string&)
+{
+  throw std::runtime_error("DirectoryBackend does not support putting values");
+}
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
@@ -0,0 +1,51 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file DirectoryBackend.h
+/// \brief Configuration interface to a directory of JSON and INI files
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_DIRECTORYBACKEND_H_
+#define O2_CONFIGURATION_BACKENDS_DIRECTORYBACKEND_H_
+
+#include "../TreeBackend.h"
+#include <string>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Backend merging all *.json and *.ini files under a directory into one tree
+/// Values of each file are placed under a prefix made of its path relative to the directory, without extension,
+/// e.g. qc/tpc.json is read from "qc.tpc". Files with the same path but different extensions are rejected.
+class DirectoryBackend final : public TreeBackend
+{
+  public:
+    /// Finds and parses the files concurrently
+    /// Throws std::runtime_error when a file cannot be read or two files have the same prefix
+    /// \param directory Path to the directory
+    /// \param resource Memory resource the parsed values are allocated from
+    DirectoryBackend(const std::string& directory,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /// Default destructor
+    virtual ~DirectoryBackend() = default;
+    virtual void putString(const std::string& path, const std::string& value) override;
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_DIRECTORYBACKEND_H_
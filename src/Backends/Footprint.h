@@ -0,0 +1,122 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file Footprint.h
+/// \brief Bytes held by standard containers of cached values
+///
+/// Containers using the default allocator cannot be measured by a memory resource. Their footprint is computed from
+/// their sizes and capacities, with the node layout of libstdc++; bookkeeping of the heap itself is not included.
+
+#ifndef O2_CONFIGURATION_BACKENDS_FOOTPRINT_H_
+#define O2_CONFIGURATION_BACKENDS_FOOTPRINT_H_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <boost/optional.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+template <typename T>
+std::enable_if_t<std::is_arithmetic_v<T>, std::size_t> footprint(T value);
+std::size_t footprint(const std::string& string);
+std::size_t footprint(const boost::optional<std::string>& value);
+std::size_t footprint(const boost::property_tree::ptree& tree);
+template <typename T>
+std::size_t footprint(const std::shared_ptr<T>& pointer);
+template <typename T>
+std::size_t footprint(const std::vector<T>& vector);
+template <typename Value>
+std::size_t footprint(const std::unordered_map<std::string, Value>& map);
+template <typename Value>
+std::size_t footprint(const std::map<std::string, Value>& map);
+
+template <typename T>
+std::enable_if_t<std::is_arithmetic_v<T>, std::size_t> footprint(T /*value*/)
+{
+  return sizeof(T);
+}
+
+inline std::size_t footprint(const std::string& string)
+{
+  // Strings fitting into the small string buffer do not allocate
+  static const std::size_t smallCapacity = std::string().capacity();
+  return sizeof(std::string) + (string.capacity() > smallCapacity ? string.capacity() + 1 : 0);
+}
+
+inline std::size_t footprint(const boost::optional<std::string>& value)
+{
+  return value ? sizeof(value) - sizeof(std::string) + footprint(*value) : sizeof(value);
+}
+
+inline std::size_t footprint(const boost::property_tree::ptree& tree)
+{
+  // Children are nodes of a sequenced and an ordered index, with two and three pointers
+  std::size_t bytes = sizeof(tree) + footprint(tree.data()) - sizeof(std::string);
+  for (const auto& child : tree) {
+    bytes += 5 * sizeof(void*) + footprint(child.first) + footprint(child.second);
+  }
+  return bytes;
+}
+
+template <typename T>
+std::size_t footprint(const std::shared_ptr<T>& pointer)
+{
+  return sizeof(pointer) + (pointer ? footprint(*pointer) : 0);
+}
+
+template <typename T>
+std::size_t footprint(const std::vector<T>& vector)
+{
+  std::size_t bytes = sizeof(vector) + (vector.capacity() - vector.size()) * sizeof(T);
+  for (const auto& element : vector) {
+    bytes += footprint(element);
+  }
+  return bytes;
+}
+
+template <typename Value>
+std::size_t footprint(const std::unordered_map<std::string, Value>& map)
+{
+  // Nodes hold the next pointer, the element and its cached hash; a single bucket is stored in the map itself
+  std::size_t bytes = sizeof(map) + (map.bucket_count() > 1 ? map.bucket_count() * sizeof(void*) : 0);
+  for (const auto& element : map) {
+    bytes += sizeof(void*) + footprint(element.first) + footprint(element.second) + sizeof(std::size_t);
+  }
+  return bytes;
+}
+
+template <typename Value>
+std::size_t footprint(const std::map<std::string, Value>& map)
+{
+  // Nodes hold the color and three pointers
+  std::size_t bytes = sizeof(map);
+  for (const auto& element : map) {
+    bytes += 4 * sizeof(void*) + footprint(element.first) + footprint(element.second);
+  }
+  return bytes;
+}
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_FOOTPRINT_H_
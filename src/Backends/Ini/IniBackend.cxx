@@ -17,6 +17,8 @@
 /// \author Pascal Boeschoten, CERN
 
 #include "IniBackend.h"
+#include "IniParser.h"
+#include "../PhaseProfiler.h"
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 #include <vector>
@@ -44,11 +46,10 @@ void loadConfigFile(const std::string& file, boost::property_tree::ptree& pt, bo
   }
   try {
     if (isStream) {
-      std::istringstream ss;
-      ss.str(file);
-      boost::property_tree::ini_parser::read_ini(ss, pt);
+      auto parse = PhaseProfiler::measure("parse");
+      readIni(file.data(), file.size(), pt);
     } else {
-      boost::property_tree::ini_parser::read_ini(file, pt);
+      readIniFile(file, pt);
     }
   } catch (const boost::property_tree::ini_parser::ini_parser_error& perr) {
     std::stringstream ss;
@@ -63,9 +64,12 @@ void loadConfigFile(const std::string& file, boost::property_tree::ptree& pt, bo
   return;
 }
 
-IniBackend::IniBackend(const std::string& file, bool isStream)
+IniBackend::IniBackend(const std::string& file, bool isStream, std::pmr::memory_resource* resource)
+  : TreeBackend(resource)
 {
-  loadConfigFile(file, mPropertyTree, isStream);
+  boost::property_tree::ptree tree;
+  loadConfigFile(file, tree, isStream);
+  setTree(tree);
 }
 
 void IniBackend::putString(const std::string&, const std::string&)
@@ -73,20 +77,6 @@ void IniBackend::putString(const std::string&, const std::string&)
   throw std::runtime_error("IniBackend does not support putting values");
 }
 
-boost::optional<std::string> IniBackend::getString(const std::string& path)
-{
-  // To use a custom separator instead of the default '.', we need to construct
-  // the path_type object explicitly
-  return mPropertyTree.get_optional<std::string>(
-    decltype(mPropertyTree)::path_type(addPrefix(path), getSeparator()));
-}
-
-boost::property_tree::ptree IniBackend::getRecursive(const std::string& path)
-{
-  return mPropertyTree.get_child(
-    decltype(mPropertyTree)::path_type(addPrefix(path), getSeparator()));
-}
-
 } // namespace backends
 } // namespace configuration
 } // namespace o2
@@ -20,7 +20,7 @@
 
 #include <string>
 #include <boost/property_tree/ptree.hpp>
-#include "../BackendBase.h"
+#include "../TreeBackend.h"
 
 namespace o2
 {
@@ -29,21 +29,26 @@ namespace configuration
 namespace backends
 {
 
+/// Parses INI data or an INI file
+/// \param file A file path or INI data
+/// \param pt Tree receiving the values
+/// \param isStream Whether file holds the data itself
+void loadConfigFile(const std::string& file, boost::property_tree::ptree& pt, bool isStream);
+
 /// Backend for .ini files
-class IniBackend final : public BackendBase
+class IniBackend final : public TreeBackend
 {
   public:
     /// Read and parse INI file
-    IniBackend(const std::string& file, bool isStream = false);
+    /// \param file A file path to INI file or INI data
+    /// \param isStream Whether file contains INI data
+    /// \param resource Memory resource the parsed values are allocated from
+    IniBackend(const std::string& file, bool isStream = false,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
     /// Default destructor
     virtual ~IniBackend() = default;
     virtual void putString(const std::string& path, const std::string& value) override;
-    virtual boost::optional<std::string> getString(const std::string& path) override;
-    virtual boost::property_tree::ptree getRecursive(const std::string&) override;
-  private:
-    /// Parsed INI file
-    boost::property_tree::ptree mPropertyTree;
 };
 
 } // namespace backends
@@ -0,0 +1,175 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file IniParser.cxx
+/// \brief Single-pass INI parser working on memory buffers
+
+#include "IniParser.h"
+#include "../Decompress.h"
+#include "../PhaseProfiler.h"
+#include <boost/property_tree/ini_parser.hpp>
+#include <cstring>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+namespace
+{
+
+using boost::property_tree::ini_parser::ini_parser_error;
+using boost::property_tree::ptree;
+
+/// Trims whitespace as std::isspace does in the "C" locale
+std::string_view trim(std::string_view text)
+{
+  constexpr const char* whitespace = " \t\n\v\f\r";
+  auto begin = text.find_first_not_of(whitespace);
+  if (begin == std::string_view::npos) {
+    return {};
+  }
+  return text.substr(begin, text.find_last_not_of(whitespace) - begin + 1);
+}
+
+/// Read-only memory mapping of a file
+class MappedFile
+{
+  public:
+    MappedFile(const std::string& file)
+    {
+      int fd = open(file.c_str(), O_RDONLY);
+      struct stat status;
+      if (fd < 0 || fstat(fd, &status) != 0 || !S_ISREG(status.st_mode)) {
+        if (fd >= 0) {
+          close(fd);
+        }
+        throw ini_parser_error("cannot open file", file, 0);
+      }
+      mSize = status.st_size;
+      if (mSize > 0) {
+        mData = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+      }
+      close(fd);
+      if (mData == MAP_FAILED) {
+        throw ini_parser_error("cannot open file", file, 0);
+      }
+      madvise(mData, mSize, MADV_SEQUENTIAL);
+    }
+
+    ~MappedFile()
+    {
+      if (mData != nullptr) {
+        munmap(mData, mSize);
+      }
+    }
+
+    const char* data() const
+    {
+      return static_cast<const char*>(mData);
+    }
+
+    std::size_t size() const
+    {
+      return mSize;
+    }
+
+  private:
+    void* mData = nullptr;
+    std::size_t mSize = 0;
+};
+
+} // Anonymous namespace
+
+void readIni(const char* data, std::size_t size, ptree& tree)
+{
+  if (isCompressed(data, size)) {
+    auto decompressed = decompress(data, size);
+    readIni(decompressed.data(), decompressed.size(), tree);
+    return;
+  }
+
+  ptree local;
+  ptree* section = nullptr;
+  unsigned long lineNumber = 0;
+  const char* end = data + size;
+
+  // memchr is vectorised by the C library, so lines are found without a per-character loop
+  for (const char* begin = data; begin < end;) {
+    lineNumber++;
+    auto newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+    auto lineEnd = newline ? newline : end;
+    auto line = trim(std::string_view(begin, lineEnd - begin));
+    begin = lineEnd + 1;
+
+    if (line.empty() || line[0] == ';' || line[0] == '#') {
+      continue;
+    }
+
+    if (line[0] == '[') {
+      // If the previous section was empty, drop it again
+      if (section && section->empty()) {
+        local.pop_back();
+      }
+      auto close = line.find(']');
+      if (close == std::string_view::npos) {
+        throw ini_parser_error("unmatched '['", "", lineNumber);
+      }
+      std::string key(trim(line.substr(1, close - 1)));
+      if (local.find(key) != local.not_found()) {
+        throw ini_parser_error("duplicate section name", "", lineNumber);
+      }
+      section = &local.push_back(std::make_pair(std::move(key), ptree()))->second;
+    } else {
+      auto& container = section ? *section : local;
+      auto equals = line.find('=');
+      if (equals == std::string_view::npos) {
+        throw ini_parser_error("'=' character not found in line", "", lineNumber);
+      }
+      if (equals == 0) {
+        throw ini_parser_error("key expected", "", lineNumber);
+      }
+      std::string key(trim(line.substr(0, equals)));
+      if (container.find(key) != container.not_found()) {
+        throw ini_parser_error("duplicate key name", "", lineNumber);
+      }
+      container.push_back(std::make_pair(std::move(key), ptree(std::string(trim(line.substr(equals + 1))))));
+    }
+  }
+
+  // If the last section was empty, drop it again
+  if (section && section->empty()) {
+    local.pop_back();
+  }
+  tree.swap(local);
+}
+
+void readIniFile(const std::string& file, ptree& tree)
+{
+  // Pages of the mapped file are read while parsing, which then includes the transfer
+  auto parse = PhaseProfiler::measure("parse");
+  MappedFile mapped(file);
+  try {
+    readIni(mapped.data(), mapped.size(), tree);
+  } catch (const ini_parser_error& error) {
+    throw ini_parser_error(error.message(), file, error.line());
+  }
+}
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
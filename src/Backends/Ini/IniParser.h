@@ -0,0 +1,48 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file IniParser.h
+/// \brief Single-pass INI parser working on memory buffers
+///
+/// Accepts the same syntax as boost::property_tree::ini_parser and reports errors
+/// with the same boost::property_tree::ini_parser_error messages and line numbers.
+
+#ifndef O2_CONFIGURATION_BACKENDS_INIPARSER_H_
+#define O2_CONFIGURATION_BACKENDS_INIPARSER_H_
+
+#include <string>
+#include <boost/property_tree/ptree.hpp>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Parses INI data held in memory
+/// \param data INI data
+/// \param size Size of the data
+/// \param tree Tree receiving the values, left untouched on error
+/// \exception boost::property_tree::ini_parser_error on syntax error
+void readIni(const char* data, std::size_t size, boost::property_tree::ptree& tree);
+
+/// Maps INI file into memory and parses it
+/// \param file Path to the file
+/// \param tree Tree receiving the values, left untouched on error
+/// \exception boost::property_tree::ini_parser_error when file cannot be read or on syntax error
+void readIniFile(const std::string& file, boost::property_tree::ptree& tree);
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_INIPARSER_H_
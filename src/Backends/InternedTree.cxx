@@ -0,0 +1,185 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file InternedTree.cxx
+/// \brief Compact tree of values with deduplicated keys and values
+///
+
+#include "InternedTree.h"
+#include <algorithm>
+#include <functional>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+namespace
+{
+
+/// Bytes held by a string object including its heap buffer
+std::size_t footprint(const StringPool::String& string)
+{
+  // Strings fitting into the small string buffer do not allocate
+  static const std::size_t smallCapacity = std::string().capacity();
+  return sizeof(std::string) + (string.capacity() > smallCapacity ? string.capacity() + 1 : 0);
+}
+
+} // Anonymous namespace
+
+StringPool::StringPool(std::pmr::memory_resource* resource) : mStrings(resource), mIndex(resource)
+{
+}
+
+auto StringPool::intern(std::string_view string) -> const String*
+{
+  mStatistics.references++;
+  auto pooled = mIndex.find(string);
+  if (pooled != mIndex.end()) {
+    mStatistics.referencedBytes += footprint(*pooled->second);
+    return pooled->second;
+  }
+  const auto& stored = mStrings.emplace_back(string);
+  mIndex.emplace(stored, &stored);
+  mStatistics.strings++;
+  mStatistics.referencedBytes += footprint(stored);
+  mStatistics.pooledBytes += footprint(stored);
+  return &stored;
+}
+
+auto StringPool::find(std::string_view string) const -> const String*
+{
+  auto pooled = mIndex.find(string);
+  return pooled != mIndex.end() ? pooled->second : nullptr;
+}
+
+InternedTree::InternedTree(const boost::property_tree::ptree& tree, std::pmr::memory_resource* upstream)
+  : mUpstream(upstream), mArena(&mUpstream), mStringResource(&mArena), mStrings(&mStringResource), mRoot(intern(tree))
+{
+}
+
+auto InternedTree::intern(const boost::property_tree::ptree& tree) -> Node
+{
+  Node node(&mArena);
+  node.value = intern(tree.data(), mValueBytes);
+  node.children.reserve(tree.size());
+  for (const auto& child : tree) {
+    auto key = intern(child.first, mKeyBytes);
+    node.children.emplace_back(key, intern(child.second));
+  }
+  // Interned names compare by pointer, the first of repeated names is found first as in a ptree
+  if (node.children.size() >= INDEXED_CHILDREN) {
+    node.index.resize(node.children.size());
+    for (uint32_t i = 0; i < node.index.size(); i++) {
+      node.index[i] = i;
+    }
+    std::sort(node.index.begin(), node.index.end(), [&node](uint32_t a, uint32_t b) {
+      auto nameA = node.children[a].first;
+      auto nameB = node.children[b].first;
+      return nameA != nameB ? std::less<const StringPool::String*>()(nameA, nameB) : a < b;
+    });
+  }
+  return node;
+}
+
+auto InternedTree::intern(std::string_view string, std::size_t& bytes) -> const StringPool::String*
+{
+  // Growing the index frees its previous buckets, only what remains allocated is counted
+  auto before = mStringResource.getAllocated();
+  auto interned = mStrings.intern(string);
+  auto after = mStringResource.getAllocated();
+  if (after > before) {
+    bytes += after - before;
+  }
+  return interned;
+}
+
+MemoryUsage InternedTree::getMemoryUsage() const
+{
+  MemoryUsage usage;
+  usage.keys = mKeyBytes;
+  usage.values = mValueBytes;
+  usage.structure = sizeof(*this) + mUpstream.getAllocated() - mKeyBytes - mValueBytes;
+  return usage;
+}
+
+auto InternedTree::find(std::string_view path, char separator) const -> const Node*
+{
+  // Same splitting as ptree paths: an empty path is the root, a trailing separator is ignored
+  const Node* node = &mRoot;
+  std::size_t position = 0;
+  while (position < path.size()) {
+    auto end = path.find(separator, position);
+    if (end == std::string_view::npos) {
+      end = path.size();
+    }
+    // A segment never interned cannot name any child
+    auto name = mStrings.find(path.substr(position, end - position));
+    if (name == nullptr) {
+      return nullptr;
+    }
+    const Node* child = nullptr;
+    if (node->index.empty()) {
+      for (const auto& it : node->children) {
+        if (it.first == name) {
+          child = &it.second;
+          break;
+        }
+      }
+    } else {
+      auto indexed = std::lower_bound(node->index.begin(), node->index.end(), name, [node](uint32_t i, const StringPool::String* value) {
+        return std::less<const StringPool::String*>()(node->children[i].first, value);
+      });
+      if (indexed != node->index.end() && node->children[*indexed].first == name) {
+        child = &node->children[*indexed].second;
+      }
+    }
+    if (child == nullptr) {
+      return nullptr;
+    }
+    node = child;
+    position = end + 1;
+  }
+  return node;
+}
+
+boost::property_tree::ptree InternedTree::toPtree(const Node& node)
+{
+  boost::property_tree::ptree tree(std::string(*node.value));
+  for (const auto& child : node.children) {
+    tree.push_back({ std::string(*child.first), toPtree(child.second) });
+  }
+  return tree;
+}
+
+void InternedTree::flatten(const Node& node, KeyValueMap& map, char separator)
+{
+  std::string key;
+  auto parse = [&](const Node& current, auto& self) -> void {
+    map[key].assign(*current.value);
+    auto length = key.size();
+    for (const auto& child : current.children) {
+      key.resize(length);
+      if (!key.empty()) {
+        key += separator;
+      }
+      key += *child.first;
+      self(child.second, self);
+    }
+    key.resize(length);
+  };
+  parse(node, parse);
+}
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
@@ -0,0 +1,165 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file InternedTree.h
+/// \brief Compact tree of values with deduplicated keys and values
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_INTERNEDTREE_H_
+#define O2_CONFIGURATION_BACKENDS_INTERNEDTREE_H_
+
+#include "Configuration/ConfigurationInterface.h"
+#include "CountingResource.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Stores a single copy of each distinct string
+/// Interned strings keep their address for the lifetime of the pool, so equal strings compare by pointer.
+class StringPool
+{
+  public:
+    using String = std::pmr::string;
+
+    /// What interning saved
+    struct Statistics {
+      /// Number of strings interned, including repeated ones
+      std::size_t references = 0;
+
+      /// Number of distinct strings stored
+      std::size_t strings = 0;
+
+      /// Bytes needed to store each reference as a separate std::string
+      std::size_t referencedBytes = 0;
+
+      /// Bytes held by the distinct strings
+      std::size_t pooledBytes = 0;
+    };
+
+    /// \param resource Memory resource of the strings and the index
+    explicit StringPool(std::pmr::memory_resource* resource);
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    /// Returns the pooled copy of a string, adding it when missing
+    const String* intern(std::string_view string);
+
+    /// Returns the pooled copy of a string, or nullptr when it was never interned
+    const String* find(std::string_view string) const;
+
+    const Statistics& getStatistics() const
+    {
+      return mStatistics;
+    }
+
+  private:
+    /// Distinct strings, a deque does not move its elements when growing
+    std::pmr::deque<String> mStrings;
+
+    /// Pooled strings by their content
+    std::pmr::unordered_map<std::string_view, const String*> mIndex;
+
+    Statistics mStatistics;
+};
+
+/// Immutable tree of values, equivalent to a ptree but with all keys and values interned
+/// All nodes and strings are allocated from a monotonic arena owned by the tree, which is released at once.
+class InternedTree
+{
+  public:
+    /// Node of the tree, children keep their order and may repeat names like in a ptree
+    struct Node {
+      explicit Node(std::pmr::memory_resource* resource) : children(resource), index(resource)
+      {
+      }
+
+      const StringPool::String* value = nullptr;
+      std::pmr::vector<std::pair<const StringPool::String*, Node>> children;
+
+      /// Positions of the children sorted by name pointer, then position; empty for nodes with few children
+      std::pmr::vector<uint32_t> index;
+    };
+
+    /// Interns all keys and values of a tree
+    /// \param tree Tree to copy
+    /// \param upstream Memory resource the arena of the tree allocates from
+    InternedTree(const boost::property_tree::ptree& tree, std::pmr::memory_resource* upstream);
+    InternedTree(const InternedTree&) = delete;
+    InternedTree& operator=(const InternedTree&) = delete;
+
+    /// Finds a node the way ptree::get_child_optional() does
+    /// \param path Path of the node
+    /// \param separator Separator of path segments
+    /// \return The node or nullptr when there is no such node
+    const Node* find(std::string_view path, char separator) const;
+
+    /// Converts a node back to a ptree
+    static boost::property_tree::ptree toPtree(const Node& node);
+
+    /// Adds all values under a node to a flat map, keyed by path relative to the node
+    static void flatten(const Node& node, KeyValueMap& map, char separator);
+
+    const StringPool::Statistics& getStatistics() const
+    {
+      return mStrings.getStatistics();
+    }
+
+    /// Reports memory taken by the arena from its upstream resource
+    /// What interning a string allocates, including the growth of the pool index, is counted as key or value by the
+    /// first use of the string; the rest of the arena, including its unused space, as structure.
+    MemoryUsage getMemoryUsage() const;
+
+  private:
+    /// Number of children from which a node is given an index, fewer are scanned
+    static constexpr std::size_t INDEXED_CHILDREN = 8;
+
+    /// Copies a ptree node and its children
+    Node intern(const boost::property_tree::ptree& tree);
+
+    /// Interns a string, adding the bytes it allocated to a counter
+    const StringPool::String* intern(std::string_view string, std::size_t& bytes);
+
+    /// Counts what the arena takes from upstream, declared first to be released last
+    CountingResource mUpstream;
+
+    /// Arena of the tree
+    std::pmr::monotonic_buffer_resource mArena;
+
+    /// Counts what interning strings takes from the arena
+    CountingResource mStringResource;
+
+    /// Bytes allocated by interning keys and values
+    std::size_t mKeyBytes = 0;
+    std::size_t mValueBytes = 0;
+
+    StringPool mStrings;
+    Node mRoot;
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_INTERNEDTREE_H_
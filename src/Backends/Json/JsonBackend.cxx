@@ -15,6 +15,8 @@
 /// \author Adam Wegrzynek, CERN
 
 #include "JsonBackend.h"
+#include "JsonParallelParser.h"
+#include "../PhaseProfiler.h"
 #include <boost/property_tree/json_parser.hpp>
 
 namespace o2
@@ -24,7 +26,8 @@ namespace configuration
 namespace backends
 {
 
-JsonBackend::JsonBackend(const std::string& file)
+JsonBackend::JsonBackend(const std::string& file, std::pmr::memory_resource* resource)
+  : TreeBackend(resource)
 {
   if (file.length() == 0) {
     throw std::runtime_error("JSON filepath is empty");
@@ -34,18 +37,19 @@ JsonBackend::JsonBackend(const std::string& file)
 
 void JsonBackend::readJsonFile(bool isStream)
 {
+  boost::property_tree::ptree tree;
   try {
     if (isStream) {
-      std::istringstream ss;
-      ss.str(mPath);
-      boost::property_tree::read_json(ss, mTree);
+      auto parse = PhaseProfiler::measure("parse");
+      parseJson(mPath.data(), mPath.size(), tree);
     } else {
-      boost::property_tree::read_json(mPath, mTree);
+      parseJsonFile(mPath, tree);
     }
   }
   catch (const boost::property_tree::ptree_error &error) {
      throw std::runtime_error("Unable to read JSON file: " + mPath);
   }
+  setTree(tree);
 }
 
 void JsonBackend::putString(const std::string&, const std::string&)
@@ -58,36 +62,6 @@ void JsonBackend::putRecursive(const std::string& path, const boost::property_tr
   write_json(path, tree);
 }
 
-boost::optional<std::string> JsonBackend::getString(const std::string& path)
-{
-  // To use a custom separator instead of the default '.', we need to construct the path_type object explicitly
-  return mTree.get_optional<std::string>(decltype(mTree)::path_type(addPrefix(path), getSeparator()));
-}
-
-boost::property_tree::ptree JsonBackend::getRecursive(const std::string& path)
-{
-  return mTree.get_child(decltype(mTree)::path_type(addPrefix(path), getSeparator()));
-}
-
-KeyValueMap JsonBackend::getRecursiveMap(const std::string& path)
-{
-  KeyValueMap map;
-  auto subTree = mTree.get_child(decltype(mTree)::path_type(addPrefix(path), getSeparator()));
-
-  // define lambda to recursively interate tree
-  using boost::property_tree::ptree;
-  std::function<void(const ptree&, std::string)> parse = [&](const ptree& node, std::string key) {
-    map[key] = std::move(node.data());
-    key = key.empty() ? "" : key + getSeparator();
-    for (auto const &it: node) {
-      parse(it.second, key + it.first);
-    }
-  };
-
-  parse(subTree, std::string());
-  return map;
-}
-
 } // namespace configuration
 } // namespace backends
 } // namespace o2
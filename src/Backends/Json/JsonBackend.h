@@ -17,7 +17,7 @@
 #ifndef O2_CONFIGURATION_BACKENDS_JSONBACKEND_H_
 #define O2_CONFIGURATION_BACKENDS_JSONBACKEND_H_
 
-#include "../BackendBase.h"
+#include "../TreeBackend.h"
 #include <string>
 #include <boost/property_tree/ptree.hpp>
 
@@ -28,24 +28,20 @@ namespace configuration
 namespace backends
 {
 
-class JsonBackend final : public BackendBase
+class JsonBackend final : public TreeBackend
 {
   public:
     /// Opens and parses JSON file
     /// \param file A file path to JSON file or JSON data
-    JsonBackend(const std::string& file);
+    /// \param resource Memory resource the parsed values are allocated from
+    JsonBackend(const std::string& file, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
     /// Default destructor
     virtual ~JsonBackend() = default;
     virtual void putString(const std::string& path, const std::string& value) override;
     virtual void putRecursive(const std::string& path, const boost::property_tree::ptree& tree) override;
-    virtual boost::optional<std::string> getString(const std::string& path) override;
-    virtual boost::property_tree::ptree getRecursive(const std::string& path) override;
-    virtual KeyValueMap getRecursiveMap(const std::string& path) override;
     void readJsonFile(bool isStream = false);
   private:
-    /// Parsed JSON file
-    boost::property_tree::ptree mTree;
     std::string mPath;
 };
 
@@ -0,0 +1,352 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file JsonFlattener.cxx
+/// \brief Incremental JSON parser producing flat key-value maps
+///
+
+#include "JsonFlattener.h"
+#include <boost/property_tree/json_parser/error.hpp>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+namespace
+{
+
+bool isWhitespace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+/// Checks JSON number grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+bool isNumber(const std::string& token)
+{
+  std::size_t i = 0;
+  auto digits = [&]() {
+    auto start = i;
+    while (i < token.size() && isDigit(token[i])) {
+      i++;
+    }
+    return i - start;
+  };
+  if (i < token.size() && token[i] == '-') {
+    i++;
+  }
+  auto start = i;
+  auto integer = digits();
+  if (integer == 0 || (integer > 1 && token[start] == '0')) {
+    return false;
+  }
+  if (i < token.size() && token[i] == '.') {
+    i++;
+    if (digits() == 0) {
+      return false;
+    }
+  }
+  if (i < token.size() && (token[i] == 'e' || token[i] == 'E')) {
+    i++;
+    if (i < token.size() && (token[i] == '+' || token[i] == '-')) {
+      i++;
+    }
+    if (digits() == 0) {
+      return false;
+    }
+  }
+  return i == token.size();
+}
+
+int hexValue(char c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+} // Anonymous namespace
+
+JsonFlattener::JsonFlattener(KeyValueMap& map, char separator) : mMap(map), mSeparator(separator)
+{
+}
+
+void JsonFlattener::error(const std::string& message) const
+{
+  throw boost::property_tree::json_parser::json_parser_error(message, "", mLine);
+}
+
+void JsonFlattener::startChild(const std::string& name)
+{
+  // Same keys as flattening a ptree: children of the root are not prefixed with the separator
+  mKey.resize(mContainers.back().keyLength);
+  if (!mKey.empty()) {
+    mKey += mSeparator;
+  }
+  mKey += name;
+}
+
+void JsonFlattener::endValue()
+{
+  mState = mContainers.empty() ? State::End : State::AfterValue;
+}
+
+void JsonFlattener::endScalar()
+{
+  if (mToken != "true" && mToken != "false" && mToken != "null" && !isNumber(mToken)) {
+    error("expected value");
+  }
+  mMap[mKey] = mToken;
+  endValue();
+}
+
+void JsonFlattener::appendCodePoint(unsigned long codePoint)
+{
+  if (codePoint < 0x80) {
+    mToken += static_cast<char>(codePoint);
+  } else if (codePoint < 0x800) {
+    mToken += static_cast<char>(0xC0 | (codePoint >> 6));
+    mToken += static_cast<char>(0x80 | (codePoint & 0x3F));
+  } else if (codePoint < 0x10000) {
+    mToken += static_cast<char>(0xE0 | (codePoint >> 12));
+    mToken += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    mToken += static_cast<char>(0x80 | (codePoint & 0x3F));
+  } else {
+    mToken += static_cast<char>(0xF0 | (codePoint >> 18));
+    mToken += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+    mToken += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    mToken += static_cast<char>(0x80 | (codePoint & 0x3F));
+  }
+}
+
+void JsonFlattener::feed(const char* data, std::size_t size)
+{
+  std::size_t i = 0;
+  while (i < size) {
+    char c = data[i];
+    switch (mState) {
+      case State::String:
+        if (c == '"') {
+          if (mIsKey) {
+            startChild(mToken);
+            mState = State::Colon;
+          } else {
+            mMap[mKey] = mToken;
+            endValue();
+          }
+        } else if (c == '\\') {
+          mState = State::Escape;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+          error("invalid code sequence");
+        } else {
+          // Copy the run of plain characters at once
+          auto start = i;
+          while (i + 1 < size && data[i + 1] != '"' && data[i + 1] != '\\' && static_cast<unsigned char>(data[i + 1]) >= 0x20) {
+            i++;
+          }
+          mToken.append(data + start, i - start + 1);
+        }
+        break;
+
+      case State::Escape:
+        mState = State::String;
+        switch (c) {
+          case '"':
+          case '\\':
+          case '/':
+            mToken += c;
+            break;
+          case 'b':
+            mToken += '\b';
+            break;
+          case 'f':
+            mToken += '\f';
+            break;
+          case 'n':
+            mToken += '\n';
+            break;
+          case 'r':
+            mToken += '\r';
+            break;
+          case 't':
+            mToken += '\t';
+            break;
+          case 'u':
+            mState = State::Unicode;
+            mCodePoint = 0;
+            mDigits = 0;
+            break;
+          default:
+            error("invalid escape sequence");
+        }
+        break;
+
+      case State::Unicode: {
+        auto value = hexValue(c);
+        if (value < 0) {
+          error("invalid escape sequence");
+        }
+        mCodePoint = mCodePoint * 16 + value;
+        if (++mDigits < 4) {
+          break;
+        }
+        mState = State::String;
+        if (mHighSurrogate) {
+          if (mCodePoint < 0xDC00 || mCodePoint > 0xDFFF) {
+            error("invalid codepoint, stray high surrogate");
+          }
+          appendCodePoint(0x10000 + ((mHighSurrogate - 0xD800) << 10) + (mCodePoint - 0xDC00));
+          mHighSurrogate = 0;
+        } else if (mCodePoint >= 0xDC00 && mCodePoint <= 0xDFFF) {
+          error("stray low surrogate");
+        } else if (mCodePoint >= 0xD800 && mCodePoint <= 0xDBFF) {
+          mHighSurrogate = mCodePoint;
+          mState = State::LowSurrogate;
+        } else {
+          appendCodePoint(mCodePoint);
+        }
+        break;
+      }
+
+      case State::LowSurrogate:
+        if (c != '\\') {
+          error("invalid codepoint, stray high surrogate");
+        }
+        mState = State::LowSurrogateU;
+        break;
+
+      case State::LowSurrogateU:
+        if (c != 'u') {
+          error("expected codepoint reference after high surrogate");
+        }
+        mState = State::Unicode;
+        mCodePoint = 0;
+        mDigits = 0;
+        break;
+
+      case State::Scalar:
+        if (isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '.' || c == '+' || c == '-') {
+          mToken += c;
+          break;
+        }
+        endScalar();
+        // The character ending the scalar belongs to the next state
+        continue;
+
+      default:
+        if (c == '\n') {
+          mLine++;
+        }
+        if (isWhitespace(c)) {
+          break;
+        }
+        switch (mState) {
+          case State::ValueOrEnd:
+            if (c == ']') {
+              mContainers.pop_back();
+              endValue();
+              break;
+            }
+            startChild("");
+            mState = State::Value;
+            continue;
+
+          case State::Value:
+            if (c == '{' || c == '[') {
+              mMap[mKey] = "";
+              mContainers.push_back({ c == '[', mKey.size() });
+              mState = c == '[' ? State::ValueOrEnd : State::KeyOrEnd;
+            } else if (c == '"') {
+              mToken.clear();
+              mIsKey = false;
+              mState = State::String;
+            } else if (c == '-' || isDigit(c) || (c >= 'a' && c <= 'z')) {
+              mToken.assign(1, c);
+              mState = State::Scalar;
+            } else {
+              error("expected value");
+            }
+            break;
+
+          case State::KeyOrEnd:
+            if (c == '}') {
+              mContainers.pop_back();
+              endValue();
+              break;
+            }
+            [[fallthrough]];
+          case State::Key:
+            if (c != '"') {
+              error("expected key string");
+            }
+            mToken.clear();
+            mIsKey = true;
+            mState = State::String;
+            break;
+
+          case State::Colon:
+            if (c != ':') {
+              error("expected ':'");
+            }
+            mState = State::Value;
+            break;
+
+          case State::AfterValue:
+            if (c == ',') {
+              if (mContainers.back().isArray) {
+                startChild("");
+                mState = State::Value;
+              } else {
+                mState = State::Key;
+              }
+            } else if (c == (mContainers.back().isArray ? ']' : '}')) {
+              mContainers.pop_back();
+              endValue();
+            } else {
+              error(mContainers.back().isArray ? "expected ']' or ','" : "expected '}' or ','");
+            }
+            break;
+
+          case State::End:
+            error("garbage after data");
+
+          default:
+            break;
+        }
+    }
+    i++;
+  }
+}
+
+void JsonFlattener::finish()
+{
+  if (mState == State::Scalar && mContainers.empty()) {
+    endScalar();
+  }
+  if (mState != State::End) {
+    error("unexpected end of input");
+  }
+}
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
@@ -0,0 +1,107 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file JsonFlattener.h
+/// \brief Incremental JSON parser producing flat key-value maps
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_JSONFLATTENER_H_
+#define O2_CONFIGURATION_BACKENDS_JSONFLATTENER_H_
+
+#include <string>
+#include <vector>
+#include "Configuration/ConfigurationInterface.h"
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Parses JSON documents fed in arbitrary chunks, e.g. as they arrive from network,
+/// and emits values directly into a key-value map without building a tree.
+/// The map holds the same entries as flattening the ptree returned by read_json:
+/// every node, including objects and arrays with empty value, keyed by its path.
+class JsonFlattener
+{
+  public:
+    /// \param map Map receiving the values
+    /// \param separator Separator of path elements
+    JsonFlattener(KeyValueMap& map, char separator);
+
+    /// Parses next chunk of the document
+    /// \exception boost::property_tree::json_parser_error on syntax error
+    void feed(const char* data, std::size_t size);
+
+    /// Checks that the document is complete
+    /// \exception boost::property_tree::json_parser_error when it is not
+    void finish();
+
+  private:
+    enum class State {
+      Value,         ///< Expects a value
+      ValueOrEnd,    ///< Expects first array element or end of array
+      KeyOrEnd,      ///< Expects first object key or end of object
+      Key,           ///< Expects object key
+      Colon,         ///< Expects ':' after object key
+      AfterValue,    ///< Expects ',' or end of object or array
+      String,        ///< Inside of string
+      Escape,        ///< After '\' in string
+      Unicode,       ///< Inside of \uXXXX escape
+      LowSurrogate,  ///< Expects '\' starting low surrogate escape
+      LowSurrogateU, ///< Expects 'u' starting low surrogate escape
+      Scalar,        ///< Inside of number or literal
+      End            ///< After the document
+    };
+
+    /// Open object or array
+    struct Container {
+      bool isArray;
+      std::size_t keyLength;
+    };
+
+    [[noreturn]] void error(const std::string& message) const;
+    void startChild(const std::string& name);
+    void endValue();
+    void endScalar();
+    void appendCodePoint(unsigned long codePoint);
+
+    KeyValueMap& mMap;
+    char mSeparator;
+    State mState = State::Value;
+    std::vector<Container> mContainers;
+
+    /// Path of the current value
+    std::string mKey;
+
+    /// Content of the current string or scalar
+    std::string mToken;
+
+    /// Whether the current string is an object key
+    bool mIsKey = false;
+
+    /// Code point of the current \uXXXX escape, and number of its digits read so far
+    unsigned long mCodePoint = 0;
+    int mDigits = 0;
+
+    /// High surrogate waiting for its low surrogate
+    unsigned long mHighSurrogate = 0;
+
+    /// Current line, for error messages
+    unsigned long mLine = 1;
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_JSONFLATTENER_H_
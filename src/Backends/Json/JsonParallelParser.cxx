@@ -0,0 +1,210 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file JsonParallelParser.cxx
+/// \brief Parsing of large JSON documents on several threads
+///
+
+#include "JsonParallelParser.h"
+#include "../Decompress.h"
+#include "../PhaseProfiler.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <boost/property_tree/json_parser.hpp>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+namespace
+{
+
+using boost::property_tree::ptree;
+
+/// Number of chunks per thread, smaller chunks balance members of uneven size
+constexpr std::size_t CHUNKS_PER_THREAD = 4;
+
+bool isWhitespace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/// Finds members of the top-level object without parsing them
+/// \return Offsets following the opening brace, each separating comma and the closing brace; empty if not an object
+std::vector<std::size_t> scanMembers(const char* data, std::size_t size)
+{
+  std::vector<std::size_t> members;
+  std::size_t i = 0;
+  while (i < size && isWhitespace(data[i])) {
+    i++;
+  }
+  if (i == size || data[i] != '{') {
+    return {};
+  }
+  members.push_back(++i);
+
+  std::size_t depth = 1;
+  for (; i < size; i++) {
+    switch (data[i]) {
+      case '"':
+        // Skip the string, brackets and commas in it are not structural
+        for (i++; i < size && data[i] != '"'; i++) {
+          if (data[i] == '\\') {
+            i++;
+          }
+        }
+        break;
+      case '{':
+      case '[':
+        depth++;
+        break;
+      case '}':
+      case ']':
+        if (--depth == 0) {
+          members.push_back(i + 1);
+          // Anything but whitespace after the object is an error reported by the serial parser
+          for (i++; i < size && isWhitespace(data[i]); i++) {
+          }
+          return i == size ? members : std::vector<std::size_t>();
+        }
+        break;
+      case ',':
+        if (depth == 1) {
+          members.push_back(i + 1);
+        }
+        break;
+    }
+  }
+  return {};
+}
+
+} // Anonymous namespace
+
+void parseJson(const char* data, std::size_t size, ptree& tree, unsigned threads)
+{
+  if (isCompressed(data, size)) {
+    auto decompressed = decompress(data, size);
+    parseJson(decompressed.data(), decompressed.size(), tree, threads);
+    return;
+  }
+
+  if (threads == 0) {
+    threads = size >= PARALLEL_PARSE_THRESHOLD ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+  }
+  auto serial = [&]() {
+    std::istringstream ss(std::string(data, size));
+    boost::property_tree::read_json(ss, tree);
+  };
+
+  auto members = threads > 1 ? scanMembers(data, size) : std::vector<std::size_t>();
+  if (members.size() < 3) {
+    serial();
+    return;
+  }
+
+  // Group consecutive members into chunks of similar size, each chunk is parsed as an object of its own
+  std::vector<std::pair<std::size_t, std::size_t>> chunks;
+  auto chunkSize = size / (threads * CHUNKS_PER_THREAD) + 1;
+  auto start = members.front();
+  for (std::size_t m = 1; m < members.size(); m++) {
+    // An empty member, like after a trailing comma, would vanish in a chunk of its own
+    auto first = members[m - 1];
+    while (first < members[m] - 1 && isWhitespace(data[first])) {
+      first++;
+    }
+    if (first == members[m] - 1) {
+      serial();
+      return;
+    }
+    if (members[m] - start >= chunkSize || m + 1 == members.size()) {
+      // Ends before the comma separating it from the next member, or before the closing brace
+      chunks.emplace_back(start, members[m] - 1);
+      start = members[m];
+    }
+  }
+
+  std::vector<ptree> trees(chunks.size());
+  std::atomic<std::size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::vector<std::future<void>> workers;
+  for (std::size_t t = 0; t < std::min<std::size_t>(threads, chunks.size()); t++) {
+    workers.push_back(std::async(std::launch::async, [&]() {
+      for (auto index = next++; index < chunks.size() && !failed; index = next++) {
+        try {
+          std::string chunk;
+          chunk.reserve(chunks[index].second - chunks[index].first + 2);
+          chunk.append(1, '{').append(data + chunks[index].first, data + chunks[index].second).append(1, '}');
+          std::istringstream ss(std::move(chunk));
+          boost::property_tree::read_json(ss, trees[index]);
+        } catch (const boost::property_tree::ptree_error&) {
+          failed = true;
+        } catch (...) {
+          // Other errors, e.g. std::bad_alloc, stop the other workers and are passed on once they finished
+          failed = true;
+          throw;
+        }
+      }
+    }));
+  }
+  for (auto& worker : workers) {
+    worker.wait();
+  }
+  for (auto& worker : workers) {
+    worker.get();
+  }
+
+  // Line numbers of errors are only right when the whole document is parsed
+  if (failed) {
+    serial();
+    return;
+  }
+
+  ptree local;
+  for (auto& chunk : trees) {
+    for (auto& child : chunk) {
+      local.push_back(ptree::value_type(child.first, ptree()))->second.swap(child.second);
+    }
+  }
+  tree.swap(local);
+}
+
+void parseJsonFile(const std::string& file, ptree& tree, unsigned threads)
+{
+  std::string data;
+  {
+    auto transfer = PhaseProfiler::measure("transfer");
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream) {
+      throw boost::property_tree::json_parser::json_parser_error("cannot open file", file, 0);
+    }
+    stream.seekg(0, std::ios::end);
+    data.resize(stream.tellg());
+    stream.seekg(0, std::ios::beg);
+    stream.read(&data[0], data.size());
+  }
+  auto parse = PhaseProfiler::measure("parse");
+  try {
+    parseJson(data.data(), data.size(), tree, threads);
+  } catch (const boost::property_tree::json_parser::json_parser_error& error) {
+    throw boost::property_tree::json_parser::json_parser_error(error.message(), file, error.line());
+  }
+}
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
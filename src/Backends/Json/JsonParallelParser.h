@@ -0,0 +1,48 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file JsonParallelParser.h
+/// \brief Parsing of large JSON documents on several threads
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_JSONPARALLELPARSER_H_
+#define O2_CONFIGURATION_BACKENDS_JSONPARALLELPARSER_H_
+
+#include <cstddef>
+#include <string>
+#include <boost/property_tree/ptree.hpp>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Documents from this size on are parsed on all hardware threads by default
+constexpr std::size_t PARALLEL_PARSE_THRESHOLD = 4 * 1024 * 1024;
+
+/// Parses JSON data into a tree, members of the top-level object are split among threads
+/// Documents that cannot be split are parsed serially. Results and errors are the same as read_json's.
+/// \param data JSON data
+/// \param size Size of the data
+/// \param tree Tree to fill
+/// \param threads Number of threads, 0 to decide by size of the data
+void parseJson(const char* data, std::size_t size, boost::property_tree::ptree& tree, unsigned threads = 0);
+
+/// Reads and parses a JSON file, see parseJson()
+void parseJsonFile(const std::string& file, boost::property_tree::ptree& tree, unsigned threads = 0);
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_JSONPARALLELPARSER_H_
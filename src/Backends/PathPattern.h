@@ -0,0 +1,125 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file PathPattern.h
+/// \brief Paths with wildcard segments, as used by getMatching()
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_PATHPATTERN_H_
+#define O2_CONFIGURATION_BACKENDS_PATHPATTERN_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Path whose segments may be wildcards: "*" matches exactly one segment, "**" any number of segments, also none
+class PathPattern
+{
+  public:
+    static constexpr std::string_view ANY = "*";
+    static constexpr std::string_view ANY_DEPTH = "**";
+
+    /// \param pattern Pattern, e.g. "qc.tasks.*.moduleName"
+    /// \param separator Separator of segments
+    PathPattern(const std::string& pattern, char separator) : mSeparator(separator)
+    {
+      for (auto segment : split(pattern)) {
+        // Repeated "**" match the same paths as a single one, but would be tried in every combination
+        if (segment == ANY_DEPTH && !mSegments.empty() && mSegments.back() == ANY_DEPTH) {
+          continue;
+        }
+        mSegments.emplace_back(segment);
+      }
+    }
+
+    const std::vector<std::string>& getSegments() const
+    {
+      return mSegments;
+    }
+
+    /// Leading segments without wildcards joined by the separator, all matching paths start with them
+    std::string getLiteralPrefix() const
+    {
+      std::string prefix;
+      for (const auto& segment : mSegments) {
+        if (segment == ANY || segment == ANY_DEPTH) {
+          break;
+        }
+        if (!prefix.empty()) {
+          prefix += mSeparator;
+        }
+        prefix += segment;
+      }
+      return prefix;
+    }
+
+    /// Tells whether a path matches
+    /// "**" are matched greedily, going back to the last one when the rest does not match.
+    bool matches(std::string_view path) const
+    {
+      auto segments = split(path);
+      std::size_t s = 0, p = 0;
+      std::size_t anyDepth = std::string::npos, anyDepthSegment = 0;
+      while (s < segments.size()) {
+        if (p < mSegments.size() && mSegments[p] == ANY_DEPTH) {
+          anyDepth = p++;
+          anyDepthSegment = s;
+        } else if (p < mSegments.size() && (mSegments[p] == ANY || mSegments[p] == segments[s])) {
+          p++;
+          s++;
+        } else if (anyDepth != std::string::npos) {
+          p = anyDepth + 1;
+          s = ++anyDepthSegment;
+        } else {
+          return false;
+        }
+      }
+      while (p < mSegments.size() && mSegments[p] == ANY_DEPTH) {
+        p++;
+      }
+      return p == mSegments.size();
+    }
+
+  private:
+    /// Splits a path into segments, an empty path has none
+    std::vector<std::string_view> split(std::string_view path) const
+    {
+      std::vector<std::string_view> segments;
+      if (path.empty()) {
+        return segments;
+      }
+      std::size_t start = 0;
+      for (auto end = path.find(mSeparator); end != std::string_view::npos; end = path.find(mSeparator, start)) {
+        segments.push_back(path.substr(start, end - start));
+        start = end + 1;
+      }
+      segments.push_back(path.substr(start));
+      return segments;
+    }
+
+    std::vector<std::string> mSegments;
+
+    char mSeparator;
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_PATHPATTERN_H_
@@ -0,0 +1,137 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file PhaseProfiler.h
+/// \brief Timing of the phases of creating and first using a backend
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_PHASEPROFILER_H_
+#define O2_CONFIGURATION_BACKENDS_PHASEPROFILER_H_
+
+#include "Configuration/ConfigurationInterface.h"
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Sums durations of named phases, in the order the phases first occurred
+/// Backends are created deep inside the factory, so phases are recorded into the profiler of the recording active on
+/// the calling thread, without passing it to every function involved. Work done on other threads is measured by the
+/// thread waiting for it.
+class PhaseProfiler
+{
+  public:
+    /// Adds the time from its creation to its destruction to a phase
+    class Scope
+    {
+      public:
+        /// \param profiler Profiler to add to, nullptr to measure nothing
+        /// \param phase Name of the phase
+        Scope(PhaseProfiler* profiler, const char* phase) : mProfiler(profiler), mPhase(phase)
+        {
+          if (mProfiler != nullptr) {
+            mStart = std::chrono::steady_clock::now();
+          }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope()
+        {
+          if (mProfiler != nullptr) {
+            mProfiler->add(mPhase, std::chrono::steady_clock::now() - mStart);
+          }
+        }
+
+      private:
+        PhaseProfiler* mProfiler;
+        const char* mPhase;
+        std::chrono::steady_clock::time_point mStart;
+    };
+
+    /// Makes a profiler the one of the calling thread until destroyed
+    class Recording
+    {
+      public:
+        explicit Recording(PhaseProfiler& profiler) : mPrevious(current())
+        {
+          current() = &profiler;
+        }
+
+        Recording(const Recording&) = delete;
+        Recording& operator=(const Recording&) = delete;
+
+        ~Recording()
+        {
+          current() = mPrevious;
+        }
+
+      private:
+        PhaseProfiler* mPrevious;
+    };
+
+    /// Measures a phase in the profiler of the calling thread, nothing when no recording is active
+    static Scope measure(const char* phase)
+    {
+      return Scope(current(), phase);
+    }
+
+    void add(const std::string& phase, std::chrono::nanoseconds duration)
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      for (auto& recorded : mPhases) {
+        if (recorded.name == phase) {
+          recorded.duration += duration;
+          return;
+        }
+      }
+      mPhases.push_back({ phase, duration });
+    }
+
+    /// Adds all phases of another profiler
+    void merge(const PhaseProfiler& other)
+    {
+      for (const auto& phase : other.get()) {
+        add(phase.name, phase.duration);
+      }
+    }
+
+    std::vector<Phase> get() const
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      return mPhases;
+    }
+
+  private:
+    static PhaseProfiler*& current()
+    {
+      thread_local PhaseProfiler* profiler = nullptr;
+      return profiler;
+    }
+
+    std::vector<Phase> mPhases;
+
+    mutable std::mutex mMutex;
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_PHASEPROFILER_H_
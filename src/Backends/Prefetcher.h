@@ -0,0 +1,142 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file Prefetcher.h
+/// \brief Concurrent fetching of prefetch manifests for remote backends
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_PREFETCHER_H_
+#define O2_CONFIGURATION_BACKENDS_PREFETCHER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Fetches paths on worker threads and collects the results
+/// Fetches still running when the deadline passes keep running, their results can be collected later.
+/// Failed fetches are dropped, so the value is requested again on demand.
+template <typename Result>
+class Prefetcher
+{
+  public:
+    using Fetch = std::function<Result(const std::string&)>;
+
+    /// Waits for all fetches to finish
+    ~Prefetcher()
+    {
+      join();
+    }
+
+    /// Waits for all started fetches to finish, regardless of the deadline
+    void join()
+    {
+      // Workers need the mutex to finish, so they are waited for without holding it
+      std::vector<std::future<void>> workers;
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        workers.swap(mWorkers);
+      }
+      for (auto& worker : workers) {
+        worker.wait();
+      }
+    }
+
+    /// Starts fetching paths concurrently
+    /// \param paths Paths to fetch
+    /// \param fetch Function fetching a single path, called from worker threads
+    /// \param concurrency Maximum number of worker threads
+    void start(const std::vector<std::string>& paths, Fetch fetch, std::size_t concurrency)
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mQueue.insert(mQueue.end(), paths.begin(), paths.end());
+      mPending += paths.size();
+      mWorkers.erase(std::remove_if(mWorkers.begin(), mWorkers.end(), [](auto& worker) {
+        return worker.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+      }), mWorkers.end());
+      for (std::size_t i = 0; i < std::min(concurrency, paths.size()); i++) {
+        mWorkers.push_back(std::async(std::launch::async, [this, fetch] { work(fetch); }));
+      }
+    }
+
+    /// Waits until all started fetches finish or the deadline passes
+    void wait(std::chrono::steady_clock::time_point deadline)
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCondition.wait_until(lock, deadline, [this] { return mPending == 0; });
+    }
+
+    /// Moves out results of finished fetches
+    /// \return Pairs of fetched path and its result
+    std::vector<std::pair<std::string, Result>> collect()
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      return std::move(mResults);
+    }
+
+  private:
+    /// Fetches queued paths until the queue is empty
+    void work(const Fetch& fetch)
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      while (!mQueue.empty()) {
+        auto path = std::move(mQueue.front());
+        mQueue.pop_front();
+        lock.unlock();
+        try {
+          auto result = fetch(path);
+          lock.lock();
+          mResults.emplace_back(std::move(path), std::move(result));
+        } catch (...) {
+          lock.lock();
+        }
+        mPending--;
+        mCondition.notify_all();
+      }
+    }
+
+    /// Paths waiting to be fetched
+    std::deque<std::string> mQueue;
+
+    /// Results not collected yet
+    std::vector<std::pair<std::string, Result>> mResults;
+
+    /// Number of queued and running fetches
+    std::size_t mPending = 0;
+
+    /// Guards the queue, results, counter and workers
+    std::mutex mMutex;
+
+    /// Notifies about finished fetches
+    std::condition_variable mCondition;
+
+    /// Worker threads
+    std::vector<std::future<void>> mWorkers;
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_PREFETCHER_H_
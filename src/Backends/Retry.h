@@ -0,0 +1,131 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file Retry.h
+/// \brief Retries with backoff and latency tracking of requests to replicated remote backends
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_RETRY_H_
+#define O2_CONFIGURATION_BACKENDS_RETRY_H_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <boost/optional.hpp>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Retry and hedging settings of requests to a remote backend
+struct RetryPolicy {
+  /// Number of attempts after the first one fails
+  unsigned retries = 0;
+
+  /// Delay before the first retry, doubled for each following one
+  std::chrono::milliseconds backoff{ 100 };
+
+  /// Upper limit of the delay between attempts
+  std::chrono::milliseconds maxBackoff{ 2000 };
+
+  /// Percentile of recent latencies after which a second request is sent to another endpoint, 0 disables hedging
+  double hedgePercentile = 0;
+};
+
+/// Latencies of the most recent successful requests
+class LatencyWindow
+{
+  public:
+    /// Minimum number of recorded latencies for a percentile to be reported
+    static constexpr std::size_t MIN_SAMPLES = 16;
+
+    void record(std::chrono::steady_clock::duration latency)
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mLatencies[mNext++ % mLatencies.size()] = latency;
+    }
+
+    /// \param percentile Percentile in (0, 100]
+    /// \return Latency not exceeded by the given percentage of recent requests, empty when too few were recorded
+    boost::optional<std::chrono::steady_clock::duration> percentile(double percentile)
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      auto count = std::min(mNext, mLatencies.size());
+      if (count < MIN_SAMPLES) {
+        return {};
+      }
+      std::array<std::chrono::steady_clock::duration, WINDOW> sorted;
+      std::copy(mLatencies.begin(), mLatencies.begin() + count, sorted.begin());
+      auto rank = std::min(count - 1, static_cast<std::size_t>(percentile / 100 * count));
+      std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.begin() + count);
+      return sorted[rank];
+    }
+
+  private:
+    /// Number of latencies kept
+    static constexpr std::size_t WINDOW = 128;
+
+    std::array<std::chrono::steady_clock::duration, WINDOW> mLatencies;
+
+    /// Number of latencies recorded so far
+    std::size_t mNext = 0;
+
+    std::mutex mMutex;
+};
+
+/// Delay before a retry: exponential backoff with "equal jitter", a random delay between half and all of it
+/// \param policy Retry settings
+/// \param retry Number of the retry, starting at 0
+inline std::chrono::milliseconds backoffDelay(const RetryPolicy& policy, unsigned retry)
+{
+  auto delay = policy.backoff.count() << std::min(retry, 16u);
+  delay = std::min<decltype(delay)>(delay, policy.maxBackoff.count());
+  thread_local std::mt19937 generator{ std::random_device{}() };
+  std::uniform_int_distribution<decltype(delay)> jitter(delay / 2, delay);
+  return std::chrono::milliseconds(jitter(generator));
+}
+
+/// Makes attempts until one succeeds or the retries run out, sleeping with a jittered backoff between them
+/// \param policy Retry settings
+/// \param attempt Makes an attempt, given its number starting at 0
+/// \param isTransient Tells whether an error is worth another attempt, others are thrown at once
+/// \return Result of the successful attempt
+/// \throw Exception of the last attempt
+template <typename Result>
+Result retry(const RetryPolicy& policy, const std::function<Result(unsigned)>& attempt,
+             const std::function<bool(const std::exception&)>& isTransient)
+{
+  for (unsigned i = 0;; i++) {
+    try {
+      return attempt(i);
+    } catch (const std::exception& error) {
+      if (i >= policy.retries || !isTransient(error)) {
+        throw;
+      }
+    }
+    std::this_thread::sleep_for(backoffDelay(policy, i));
+  }
+}
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_RETRY_H_
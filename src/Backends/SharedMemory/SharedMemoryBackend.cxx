@@ -0,0 +1,232 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SharedMemoryBackend.cxx
+/// \brief Configuration interface to snapshots published in shared memory
+///
+
+#include "SharedMemoryBackend.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+namespace
+{
+
+/// Number of tries to map the latest version while the publisher replaces it
+constexpr int MAX_MAP_ATTEMPTS = 10;
+
+} // Anonymous namespace
+
+SharedMemoryBackend::SharedMemoryBackend(const std::string& name) : mName(name)
+{
+  // Mapping the segments is the connection to the publisher
+  auto connecting = PhaseProfiler::measure("connect");
+  mControl = shm::Segment::open(shm::controlName(name));
+  if (!mControl) {
+    throw std::runtime_error("No configuration published in shared memory: " + name);
+  }
+  auto control = reinterpret_cast<const shm::Control*>(mControl->data());
+  if (mControl->size() < sizeof(shm::Control) || control->magic != shm::MAGIC
+      || control->layoutVersion != shm::LAYOUT_VERSION) {
+    throw std::runtime_error("Incompatible shared memory configuration: " + name);
+  }
+  update();
+}
+
+void SharedMemoryBackend::update()
+{
+  auto control = reinterpret_cast<const shm::Control*>(mControl->data());
+  for (int attempt = 0; attempt < MAX_MAP_ATTEMPTS; attempt++) {
+    auto version = control->version.load(std::memory_order_acquire);
+    if (version == mVersion) {
+      return;
+    }
+    if (version == 0) {
+      throw std::runtime_error("No configuration published in shared memory: " + mName);
+    }
+    auto data = shm::Segment::open(shm::dataName(mName, version));
+    if (!data) {
+      // Removed after publication of a newer version in the meantime
+      continue;
+    }
+    auto header = reinterpret_cast<const shm::SnapshotHeader*>(data->data());
+    if (data->size() < sizeof(shm::SnapshotHeader) || header->magic != shm::MAGIC
+        || header->layoutVersion != shm::LAYOUT_VERSION || header->version != version || header->size != data->size()) {
+      throw std::runtime_error("Incompatible shared memory configuration: " + mName);
+    }
+    mData = std::move(data);
+    mVersion = version;
+    return;
+  }
+  if (!mData) {
+    throw std::runtime_error("Unable to map configuration from shared memory: " + mName);
+  }
+}
+
+uint64_t SharedMemoryBackend::getVersion()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  update();
+  return mVersion;
+}
+
+const shm::Node* SharedMemoryBackend::nodes() const
+{
+  return reinterpret_cast<const shm::Node*>(mData->data() + sizeof(shm::SnapshotHeader));
+}
+
+const uint32_t* SharedMemoryBackend::childIndex() const
+{
+  auto header = reinterpret_cast<const shm::SnapshotHeader*>(mData->data());
+  return reinterpret_cast<const uint32_t*>(mData->data() + header->indexOffset);
+}
+
+std::string_view SharedMemoryBackend::key(const shm::Node& node) const
+{
+  auto header = reinterpret_cast<const shm::SnapshotHeader*>(mData->data());
+  return std::string_view(mData->data() + header->stringsOffset + node.key, node.keySize);
+}
+
+std::string_view SharedMemoryBackend::value(const shm::Node& node) const
+{
+  auto header = reinterpret_cast<const shm::SnapshotHeader*>(mData->data());
+  return std::string_view(mData->data() + header->stringsOffset + node.value, node.valueSize);
+}
+
+const shm::Node* SharedMemoryBackend::find(const std::string& path) const
+{
+  // Same splitting as ptree paths: an empty path is the root, a trailing separator is ignored
+  const shm::Node* node = nodes();
+  std::size_t position = 0;
+  while (position < path.size()) {
+    auto end = path.find(getSeparator(), position);
+    if (end == std::string::npos) {
+      end = path.size();
+    }
+    auto name = std::string_view(path).substr(position, end - position);
+    auto begin = childIndex() + node->children;
+    auto sorted = std::lower_bound(begin, begin + node->childCount, name, [this](uint32_t i, std::string_view value) {
+      return key(nodes()[i]) < value;
+    });
+    if (sorted == begin + node->childCount || key(nodes()[*sorted]) != name) {
+      return nullptr;
+    }
+    node = &nodes()[*sorted];
+    position = end + 1;
+  }
+  return node;
+}
+
+const shm::Node& SharedMemoryBackend::getNode(const std::string& path) const
+{
+  auto node = find(path);
+  if (node == nullptr) {
+    throw boost::property_tree::ptree_bad_path("No such node", boost::property_tree::ptree::path_type(path, getSeparator()));
+  }
+  return *node;
+}
+
+void SharedMemoryBackend::putString(const std::string&, const std::string&)
+{
+  throw std::runtime_error("Shared memory backend does not support putting values");
+}
+
+boost::optional<std::string> SharedMemoryBackend::getString(const std::string& path)
+{
+  auto lookup = measureFirstLookup();
+  std::lock_guard<std::mutex> lock(mMutex);
+  update();
+  auto node = find(addPrefix(path));
+  if (node == nullptr) {
+    return {};
+  }
+  return std::string(value(*node));
+}
+
+boost::property_tree::ptree SharedMemoryBackend::getRecursive(const std::string& path)
+{
+  auto lookup = measureFirstLookup();
+  std::lock_guard<std::mutex> lock(mMutex);
+  update();
+  using boost::property_tree::ptree;
+  auto build = [this](const shm::Node& node, auto& self) -> ptree {
+    ptree tree{ std::string(value(node)) };
+    for (auto i = node.children; i < node.children + node.childCount; i++) {
+      tree.push_back({ std::string(key(nodes()[i])), self(nodes()[i], self) });
+    }
+    return tree;
+  };
+  return build(getNode(addPrefix(path)), build);
+}
+
+void SharedMemoryBackend::visitChildren(const std::string& path, const std::function<void(std::string_view)>& visit)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  update();
+  const auto& node = getNode(addPrefix(path));
+  for (auto i = node.children; i < node.children + node.childCount; i++) {
+    visit(value(nodes()[i]));
+  }
+}
+
+MemoryUsage SharedMemoryBackend::memoryUsage()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  update();
+  auto header = reinterpret_cast<const shm::SnapshotHeader*>(mData->data());
+  MemoryUsage usage;
+  usage.structure = mControl->size() + header->stringsOffset;
+  std::unordered_set<uint32_t> counted;
+  for (std::size_t i = 0; i < header->nodeCount; i++) {
+    const auto& node = nodes()[i];
+    if (node.keySize != 0 && counted.insert(node.key).second) {
+      usage.keys += node.keySize;
+    }
+    if (node.valueSize != 0 && counted.insert(node.value).second) {
+      usage.values += node.valueSize;
+    }
+  }
+  return usage;
+}
+
+KeyValueMap SharedMemoryBackend::getRecursiveMap(const std::string& path)
+{
+  auto lookup = measureFirstLookup();
+  std::lock_guard<std::mutex> lock(mMutex);
+  update();
+  KeyValueMap map;
+  std::string prefix;
+  auto parse = [&](const shm::Node& node, auto& self) -> void {
+    map[prefix] = value(node);
+    auto length = prefix.size();
+    for (auto i = node.children; i < node.children + node.childCount; i++) {
+      prefix.resize(length);
+      if (!prefix.empty()) {
+        prefix += getSeparator();
+      }
+      prefix += key(nodes()[i]);
+      self(nodes()[i], self);
+    }
+    prefix.resize(length);
+  };
+  parse(getNode(addPrefix(path)), parse);
+  return map;
+}
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
@@ -0,0 +1,99 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SharedMemoryBackend.h
+/// \brief Configuration interface to snapshots published in shared memory
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_SHAREDMEMORYBACKEND_H_
+#define O2_CONFIGURATION_BACKENDS_SHAREDMEMORYBACKEND_H_
+
+#include "../BackendBase.h"
+#include "SharedMemoryLayout.h"
+#include "SharedMemorySegment.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Backend reading a snapshot published by SharedMemoryPublisher
+/// The snapshot is mapped read-only and values are looked up in place. A newly published version is mapped
+/// on the next get operation.
+class SharedMemoryBackend final : public BackendBase
+{
+  public:
+    /// Maps the latest published version
+    /// \param name Name of the snapshot
+    SharedMemoryBackend(const std::string& name);
+
+    /// Default destructor
+    virtual ~SharedMemoryBackend() = default;
+    virtual void putString(const std::string& path, const std::string& value) override;
+    virtual boost::optional<std::string> getString(const std::string& path) override;
+    virtual boost::property_tree::ptree getRecursive(const std::string& path) override;
+    virtual KeyValueMap getRecursiveMap(const std::string& path) override;
+
+    /// Reports the mapped segments, strings shared by several nodes are counted once as keys or values by their first use
+    virtual MemoryUsage memoryUsage() override;
+
+    /// Returns version of the snapshot in use, after mapping the latest one
+    uint64_t getVersion();
+
+  protected:
+    /// Reads the values in place in the mapped snapshot
+    virtual void visitChildren(const std::string& path, const std::function<void(std::string_view)>& visit) override;
+
+  private:
+    /// Maps the latest published version if it changed
+    void update();
+
+    /// Finds a node the way ptree::get_child_optional() does
+    /// \return The node or nullptr when there is no such node
+    const shm::Node* find(const std::string& path) const;
+
+    /// Finds a node, throws ptree_bad_path like ptree::get_child() when missing
+    const shm::Node& getNode(const std::string& path) const;
+
+    const shm::Node* nodes() const;
+
+    /// Children of each node sorted by key, see shm::SnapshotHeader::indexOffset
+    const uint32_t* childIndex() const;
+    std::string_view key(const shm::Node& node) const;
+    std::string_view value(const shm::Node& node) const;
+
+    /// Name of the snapshot
+    std::string mName;
+
+    /// Mapped control segment
+    std::unique_ptr<shm::Segment> mControl;
+
+    /// Mapped data segment of the version in use
+    std::unique_ptr<shm::Segment> mData;
+
+    /// Version in use
+    uint64_t mVersion = 0;
+
+    /// Guards switching of versions during lookups
+    std::mutex mMutex;
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_SHAREDMEMORYBACKEND_H_
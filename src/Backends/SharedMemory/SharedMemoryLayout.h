@@ -0,0 +1,106 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SharedMemoryLayout.h
+/// \brief Layout of configuration snapshots published in POSIX shared memory
+///
+/// A snapshot named "name" consists of a control segment "/o2-configuration-name" holding the version currently
+/// published, and one data segment per version, "/o2-configuration-name.<version>". Data segments are never modified
+/// after being published, the publisher keeps the current and the previous version and removes older ones.
+/// The control segment outlives publishers, so that readers follow the versions of a publisher started again.
+/// All references inside a data segment are offsets, so it can be mapped at any address.
+
+#ifndef O2_CONFIGURATION_BACKENDS_SHAREDMEMORYLAYOUT_H_
+#define O2_CONFIGURATION_BACKENDS_SHAREDMEMORYLAYOUT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+namespace shm
+{
+
+/// Identifies segments written by this library
+constexpr uint64_t MAGIC = 0x4d48534746433230; // "02CFGSHM"
+
+/// Incremented when the layout changes
+constexpr uint32_t LAYOUT_VERSION = 2;
+
+/// Content of the control segment
+struct Control {
+  uint64_t magic;
+  uint32_t layoutVersion;
+  uint32_t reserved;
+
+  /// Version of the data segment to read, 0 until the first publication
+  std::atomic<uint64_t> version;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Version must be lock-free to be shared between processes");
+
+/// Beginning of a data segment, followed by the nodes, the child index and the strings
+struct SnapshotHeader {
+  uint64_t magic;
+  uint32_t layoutVersion;
+  uint32_t nodeCount;
+
+  /// Version of the snapshot, same as in the name of the segment
+  uint64_t version;
+
+  /// Offset of the child index from the beginning of the segment
+  /// The index holds a node index per node: entries of the range of each node's children are those children sorted by
+  /// key, children with the same key by position.
+  uint64_t indexOffset;
+
+  /// Offset of the strings from the beginning of the segment
+  uint64_t stringsOffset;
+
+  /// Size of the segment in bytes
+  uint64_t size;
+};
+
+/// Node of the tree, children of a node are stored next to each other
+/// The root is the first node, nodes are stored in breadth-first order.
+struct Node {
+  /// Offset and size of the key in the strings
+  uint32_t key;
+  uint32_t keySize;
+
+  /// Offset and size of the value in the strings
+  uint32_t value;
+  uint32_t valueSize;
+
+  /// Index of the first child and number of children
+  uint32_t children;
+  uint32_t childCount;
+};
+
+inline std::string controlName(const std::string& name)
+{
+  return "/o2-configuration-" + name;
+}
+
+inline std::string dataName(const std::string& name, uint64_t version)
+{
+  return controlName(name) + "." + std::to_string(version);
+}
+
+} // namespace shm
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_SHAREDMEMORYLAYOUT_H_
@@ -0,0 +1,119 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SharedMemorySegment.h
+/// \brief Mapping of a POSIX shared memory object
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_SHAREDMEMORYSEGMENT_H_
+#define O2_CONFIGURATION_BACKENDS_SHAREDMEMORYSEGMENT_H_
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+namespace shm
+{
+
+/// Shared memory object mapped into the address space, unmapped on destruction
+/// The mapping stays valid after the object is removed by another process.
+class Segment
+{
+  public:
+    /// Maps an existing object read-only
+    /// \return The mapping, or nullptr when there is no such object or it is still empty
+    static std::unique_ptr<Segment> open(const std::string& name)
+    {
+      int fd = shm_open(name.c_str(), O_RDONLY, 0);
+      if (fd < 0) {
+        if (errno == ENOENT) {
+          return nullptr;
+        }
+        throw std::runtime_error("Unable to open shared memory " + name + ": " + std::strerror(errno));
+      }
+      struct stat status;
+      if (fstat(fd, &status) != 0) {
+        close(fd);
+        throw std::runtime_error("Unable to open shared memory " + name + ": " + std::strerror(errno));
+      }
+      // Created, but not sized yet
+      if (status.st_size == 0) {
+        close(fd);
+        return nullptr;
+      }
+      return std::unique_ptr<Segment>(new Segment(name, fd, status.st_size, PROT_READ));
+    }
+
+    /// Maps an object for writing, creating it when missing
+    /// \param size Size of the object, it is resized when it differs
+    static std::unique_ptr<Segment> create(const std::string& name, std::size_t size)
+    {
+      int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+      if (fd < 0 || ftruncate(fd, size) != 0) {
+        auto error = errno;
+        if (fd >= 0) {
+          close(fd);
+        }
+        throw std::runtime_error("Unable to create shared memory " + name + ": " + std::strerror(error));
+      }
+      return std::unique_ptr<Segment>(new Segment(name, fd, size, PROT_READ | PROT_WRITE));
+    }
+
+    ~Segment()
+    {
+      munmap(mData, mSize);
+    }
+
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+
+    char* data() const
+    {
+      return static_cast<char*>(mData);
+    }
+
+    std::size_t size() const
+    {
+      return mSize;
+    }
+
+  private:
+    Segment(const std::string& name, int fd, std::size_t size, int protection) : mSize(size)
+    {
+      mData = mmap(nullptr, mSize, protection, MAP_SHARED, fd, 0);
+      close(fd);
+      if (mData == MAP_FAILED) {
+        throw std::runtime_error("Unable to map shared memory " + name + ": " + std::strerror(errno));
+      }
+    }
+
+    void* mData;
+    std::size_t mSize;
+};
+
+} // namespace shm
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_SHAREDMEMORYSEGMENT_H_
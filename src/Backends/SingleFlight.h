@@ -0,0 +1,106 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SingleFlight.h
+/// \brief Coalescing of concurrent identical requests of remote backends
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_SINGLEFLIGHT_H_
+#define O2_CONFIGURATION_BACKENDS_SINGLEFLIGHT_H_
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Number of requests made and saved by coalescing
+struct SingleFlightStatistics {
+  /// Requests actually made
+  std::size_t requests = 0;
+
+  /// Calls served by a request made for another caller
+  std::size_t coalesced = 0;
+};
+
+/// Runs at most one request per key at a time, concurrent callers with the same key wait for its result
+/// Results are not kept once the request finishes, so later calls make a new request.
+template <typename Result>
+class SingleFlight
+{
+  public:
+    /// Makes the request, or waits for the one in flight for the same key
+    /// \param key Identifies the request
+    /// \param fetch Makes the request, its exception is thrown to all waiting callers
+    /// \return Result of the request
+    Result run(const std::string& key, const std::function<Result()>& fetch)
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      auto inFlight = mInFlight.find(key);
+      if (inFlight != mInFlight.end()) {
+        auto future = inFlight->second;
+        mStatistics.coalesced++;
+        lock.unlock();
+        return future.get();
+      }
+      std::promise<Result> promise;
+      mInFlight.emplace(key, promise.get_future().share());
+      mStatistics.requests++;
+      lock.unlock();
+
+      try {
+        auto result = fetch();
+        promise.set_value(result);
+        finish(key);
+        return result;
+      } catch (...) {
+        promise.set_exception(std::current_exception());
+        finish(key);
+        throw;
+      }
+    }
+
+    SingleFlightStatistics getStatistics()
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      return mStatistics;
+    }
+
+  private:
+    void finish(const std::string& key)
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mInFlight.erase(key);
+    }
+
+    /// Results of requests in flight
+    std::unordered_map<std::string, std::shared_future<Result>> mInFlight;
+
+    SingleFlightStatistics mStatistics;
+
+    /// Guards requests in flight and statistics
+    std::mutex mMutex;
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_SINGLEFLIGHT_H_
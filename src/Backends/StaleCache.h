@@ -0,0 +1,265 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file StaleCache.h
+/// \brief Stale-while-revalidate cache of remote backend responses
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_STALECACHE_H_
+#define O2_CONFIGURATION_BACKENDS_STALECACHE_H_
+
+#include "Footprint.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Serves cached results at once and refreshes them on a background thread
+/// Results older than the soft TTL are returned and refreshed in the background; only results older than
+/// the hard TTL are fetched before returning. When fetching fails, the cached result is returned and the cache
+/// reports itself unhealthy until a fetch succeeds again.
+template <typename Result>
+class StaleCache
+{
+  public:
+    using Fetch = std::function<Result()>;
+
+    ~StaleCache()
+    {
+      stop();
+    }
+
+    /// Stops the background thread, waiting for the running refresh
+    void stop()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+      }
+      mCondition.notify_all();
+      if (mWorker.joinable()) {
+        mWorker.join();
+      }
+    }
+
+    /// Sets the TTLs, the cache is enabled when the soft TTL is not zero
+    /// \param soft Age after which a result is refreshed in the background
+    /// \param hard Age after which a result is fetched before returning, zero to always return the cached result
+    void setTtl(std::chrono::milliseconds soft, std::chrono::milliseconds hard)
+    {
+      mSoftTtl = soft;
+      mHardTtl = hard;
+    }
+
+    bool isEnabled() const
+    {
+      return mSoftTtl.count() > 0;
+    }
+
+    /// Tells whether the last fetch succeeded
+    bool isHealthy() const
+    {
+      return mHealthy;
+    }
+
+    /// Returns the cached result, fetching it when not cached or older than the hard TTL
+    /// \param key Identifies the result
+    /// \param fetch Fetches the result, also called from the background thread
+    /// \throw Exception of the fetch when there is no cached result
+    Result get(const std::string& key, const Fetch& fetch)
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      auto now = std::chrono::steady_clock::now();
+      auto entry = mEntries.find(key);
+      if (entry != mEntries.end() && (mHardTtl.count() == 0 || now - entry->second.fetched < mHardTtl)) {
+        if (now >= entry->second.nextRefresh && !entry->second.refreshing && !mStop) {
+          entry->second.refreshing = true;
+          mQueue.push_back({ key, fetch, entry->second.generation });
+          if (!mWorker.joinable()) {
+            mWorker = std::thread([this] { work(); });
+          }
+          mCondition.notify_one();
+        }
+        return entry->second.value;
+      }
+      auto invalidations = mInvalidations;
+      lock.unlock();
+
+      try {
+        auto result = fetch();
+        lock.lock();
+        // A result fetched while keys were invalidated may predate the change, it is returned but not cached
+        if (mInvalidations == invalidations) {
+          store(key, result);
+        }
+        return result;
+      } catch (...) {
+        lock.lock();
+        entry = mEntries.find(key);
+        if (entry == mEntries.end()) {
+          throw;
+        }
+        // The server is unreachable, stale data is better than none
+        mHealthy = false;
+        entry->second.nextRefresh = std::chrono::steady_clock::now() + mSoftTtl;
+        return entry->second.value;
+      }
+    }
+
+    /// Bytes held by cached results, computed as described in Footprint.h
+    std::size_t getFootprint()
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      std::size_t bytes = mEntries.bucket_count() > 1 ? mEntries.bucket_count() * sizeof(void*) : 0;
+      for (const auto& entry : mEntries) {
+        bytes += sizeof(void*) + footprint(entry.first) + sizeof(Entry) - sizeof(Result) + footprint(entry.second.value)
+                 + sizeof(std::size_t);
+      }
+      return bytes;
+    }
+
+    /// Drops cached results which the given key may have changed
+    /// Results of refreshes running meanwhile are dropped as well, they may predate the change.
+    /// \param key Changed key; results of the key itself and of its prefixes are dropped
+    void invalidate(const std::string& key)
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mInvalidations++;
+      for (auto entry = mEntries.begin(); entry != mEntries.end();) {
+        if (key.compare(0, entry->first.size(), entry->first) == 0) {
+          entry = mEntries.erase(entry);
+        } else {
+          ++entry;
+        }
+      }
+    }
+
+  private:
+    struct Entry {
+      Result value;
+
+      /// When the value was fetched
+      std::chrono::steady_clock::time_point fetched;
+
+      /// When the value is due to be refreshed
+      std::chrono::steady_clock::time_point nextRefresh;
+
+      /// Whether a background refresh of this generation is queued or running
+      bool refreshing = false;
+
+      /// Distinguishes the entry from entries stored earlier under the same key
+      uint64_t generation = 0;
+    };
+
+    /// Background refresh of an entry
+    struct Refresh {
+      std::string key;
+      Fetch fetch;
+
+      /// Generation of the entry, its result is dropped when the entry was replaced or invalidated meanwhile
+      uint64_t generation;
+    };
+
+    /// Stores a fetched result as a new generation, the mutex must be held
+    void store(const std::string& key, const Result& result)
+    {
+      auto now = std::chrono::steady_clock::now();
+      auto& entry = mEntries[key];
+      entry.value = result;
+      entry.fetched = now;
+      entry.nextRefresh = now + mSoftTtl;
+      entry.refreshing = false;
+      entry.generation = ++mGenerations;
+      mHealthy = true;
+    }
+
+    /// Runs queued refreshes until stopped
+    void work()
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      while (true) {
+        mCondition.wait(lock, [this] { return mStop || !mQueue.empty(); });
+        if (mStop) {
+          return;
+        }
+        auto refresh = std::move(mQueue.front());
+        mQueue.pop_front();
+        lock.unlock();
+        try {
+          auto result = refresh.fetch();
+          lock.lock();
+          auto entry = mEntries.find(refresh.key);
+          if (entry != mEntries.end() && entry->second.generation == refresh.generation) {
+            store(refresh.key, result);
+          }
+        } catch (...) {
+          lock.lock();
+          mHealthy = false;
+          auto entry = mEntries.find(refresh.key);
+          if (entry != mEntries.end() && entry->second.generation == refresh.generation) {
+            entry->second.nextRefresh = std::chrono::steady_clock::now() + mSoftTtl;
+            entry->second.refreshing = false;
+          }
+        }
+      }
+    }
+
+    /// Cached results, by key
+    std::unordered_map<std::string, Entry> mEntries;
+
+    /// Refreshes waiting for the background thread
+    std::deque<Refresh> mQueue;
+
+    /// Number of generations stored so far
+    uint64_t mGenerations = 0;
+
+    /// Number of invalidate() calls so far
+    uint64_t mInvalidations = 0;
+
+    std::chrono::milliseconds mSoftTtl{ 0 };
+
+    std::chrono::milliseconds mHardTtl{ 0 };
+
+    /// Whether the last fetch succeeded
+    std::atomic<bool> mHealthy{ true };
+
+    /// Whether the background thread is asked to stop
+    bool mStop = false;
+
+    /// Guards entries, queue and stop flag
+    std::mutex mMutex;
+
+    /// Notifies the background thread about queued refreshes
+    std::condition_variable mCondition;
+
+    /// Background thread, started by the first refresh
+    std::thread mWorker;
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_STALECACHE_H_
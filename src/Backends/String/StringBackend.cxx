@@ -14,6 +14,7 @@
 ///
 
 #include "StringBackend.h"
+#include "../PhaseProfiler.h"
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/tokenizer.hpp>
@@ -26,25 +27,31 @@ namespace configuration
 namespace backends
 {
 
-StringBackend::StringBackend(const std::string& s)
+StringBackend::StringBackend(const std::string& s, std::pmr::memory_resource* resource)
+  : TreeBackend(resource)
 {
   auto cfgStr = boost::trim_copy_if(s, boost::is_any_of(" \n\t"));
   if (cfgStr.empty()) {
     throw std::runtime_error("string cfg is empty");
   }
 
-  std::vector<std::string> tokens;
-  boost::split(tokens, s, boost::is_any_of(";"));
+  boost::property_tree::ptree tree;
+  {
+    auto parse = PhaseProfiler::measure("parse");
+    std::vector<std::string> tokens;
+    boost::split(tokens, s, boost::is_any_of(";"));
 
-  for (auto& token : tokens) {
-    const auto equals_idx = token.find_first_of('=');
-    if (std::string::npos != equals_idx) {
-      mTree.put(boost::trim_copy(token.substr(0, equals_idx)),
-                boost::trim_copy(token.substr(equals_idx + 1)));
-    } else {
-      throw std::runtime_error("Not a key value pair" + token);
+    for (auto& token : tokens) {
+      const auto equals_idx = token.find_first_of('=');
+      if (std::string::npos != equals_idx) {
+        tree.put(boost::trim_copy(token.substr(0, equals_idx)),
+                 boost::trim_copy(token.substr(equals_idx + 1)));
+      } else {
+        throw std::runtime_error("Not a key value pair" + token);
+      }
     }
   }
+  setTree(tree);
 }
 
 void StringBackend::putString(const std::string&, const std::string&)
@@ -52,37 +59,6 @@ void StringBackend::putString(const std::string&, const std::string&)
   throw std::runtime_error("String backend does not support putting values");
 }
 
-boost::optional<std::string> StringBackend::getString(const std::string& path)
-{
-  // To use a custom separator instead of the default '.', we need to construct the path_type object explicitly
-  return mTree.get_optional<std::string>(decltype(mTree)::path_type(addPrefix(path), getSeparator()));
-}
-
-boost::property_tree::ptree
-  StringBackend::getRecursive(const std::string& path)
-{
-  return mTree.get_child(decltype(mTree)::path_type(addPrefix(path), getSeparator()));
-}
-
-KeyValueMap StringBackend::getRecursiveMap(const std::string& path)
-{
-  KeyValueMap map;
-  auto subTree = mTree.get_child(decltype(mTree)::path_type(addPrefix(path), getSeparator()));
-
-  // define lambda to recursively interate tree
-  using boost::property_tree::ptree;
-  std::function<void(const ptree&, std::string)> parse = [&](const ptree& node, std::string key) {
-    map[key] = std::move(node.data());
-    key = key.empty() ? "" : key + getSeparator();
-    for (auto const& it : node) {
-      parse(it.second, key + it.first);
-    }
-  };
-
-  parse(subTree, std::string());
-  return map;
-}
-
 } // namespace backends
 } // namespace configuration
 } // namespace o2
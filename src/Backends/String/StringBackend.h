@@ -16,7 +16,7 @@
 #ifndef O2_CONFIGURATION_BACKENDS_STRINGBACKEND_H_
 #define O2_CONFIGURATION_BACKENDS_STRINGBACKEND_H_
 
-#include "../BackendBase.h"
+#include "../TreeBackend.h"
 #include <string>
 #include <boost/property_tree/ptree.hpp>
 
@@ -27,26 +27,19 @@ namespace configuration
 namespace backends
 {
 
-class StringBackend final : public BackendBase
+class StringBackend final : public TreeBackend
 {
  public:
   /// Interprets a string as key value pairs.
   /// \param s the key=value;key2=value2 string to be used as configuration
-  StringBackend(const std::string& s);
+  /// \param resource Memory resource the parsed values are allocated from
+  StringBackend(const std::string& s,
+                std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
   /// Default destructor
   virtual ~StringBackend() = default;
   virtual void putString(const std::string& path,
                          const std::string& value) override;
-  virtual boost::optional<std::string>
-    getString(const std::string& path) override;
-  virtual boost::property_tree::ptree
-    getRecursive(const std::string& path) override;
-  virtual KeyValueMap getRecursiveMap(const std::string& path) override;
-
- private:
-  boost::property_tree::ptree mTree;
-  std::string mPath;
 };
 
 } // namespace backends
@@ -0,0 +1,186 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file TreeBackend.cxx
+/// \brief Base class for backends holding all values in memory in a tree
+///
+
+#include "TreeBackend.h"
+#include "Footprint.h"
+#include "PathPattern.h"
+#include <algorithm>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+TreeBackend::TreeBackend(std::pmr::memory_resource* resource)
+  : mResource(resource), mTree(std::make_shared<const InternedTree>(boost::property_tree::ptree(), resource))
+{
+}
+
+void TreeBackend::setTree(const boost::property_tree::ptree& tree)
+{
+  auto index = PhaseProfiler::measure("index");
+  setTree(std::make_shared<const InternedTree>(tree, mResource));
+}
+
+void TreeBackend::setTree(std::shared_ptr<const InternedTree> tree)
+{
+  // The previous tree and its arena are released at once, unless shared with other backends
+  std::lock_guard<std::mutex> lock(mSharedMapsMutex);
+  std::atomic_store(&mTree, std::move(tree));
+  mSharedMaps.clear();
+}
+
+boost::optional<std::string> TreeBackend::getString(const std::string& path)
+{
+  auto lookup = measureFirstLookup();
+  auto tree = getTree();
+  auto node = tree->find(addPrefix(path), getSeparator());
+  if (node == nullptr) {
+    return {};
+  }
+  return std::string(*node->value);
+}
+
+auto TreeBackend::getNode(const InternedTree& tree, const std::string& path) -> const InternedTree::Node&
+{
+  auto fullPath = addPrefix(path);
+  auto node = tree.find(fullPath, getSeparator());
+  if (node == nullptr) {
+    throw boost::property_tree::ptree_bad_path("No such node", boost::property_tree::ptree::path_type(fullPath, getSeparator()));
+  }
+  return *node;
+}
+
+boost::property_tree::ptree TreeBackend::getRecursive(const std::string& path)
+{
+  auto lookup = measureFirstLookup();
+  auto tree = getTree();
+  return InternedTree::toPtree(getNode(*tree, path));
+}
+
+KeyValueMap TreeBackend::getRecursiveMap(const std::string& path)
+{
+  auto lookup = measureFirstLookup();
+  auto tree = getTree();
+  KeyValueMap map;
+  InternedTree::flatten(getNode(*tree, path), map, getSeparator());
+  return map;
+}
+
+KeyValueMap TreeBackend::getMatching(const std::string& pattern)
+{
+  KeyValueMap map;
+  auto tree = getTree();
+  auto root = tree->find(addPrefix(""), getSeparator());
+  if (root == nullptr) {
+    return map;
+  }
+  PathPattern matcher(pattern, getSeparator());
+  const auto& segments = matcher.getSegments();
+  std::string key;
+  auto walk = [&](const InternedTree::Node& node, std::size_t segment, auto& self) -> void {
+    if (segment == segments.size()) {
+      map[key].assign(*node.value);
+      return;
+    }
+    const auto& wildcard = segments[segment];
+    if (wildcard == PathPattern::ANY_DEPTH) {
+      // Either no more segments, or one more while staying on "**"
+      self(node, segment + 1, self);
+    }
+    auto length = key.size();
+    for (const auto& child : node.children) {
+      if (wildcard != PathPattern::ANY && wildcard != PathPattern::ANY_DEPTH && std::string_view(*child.first) != wildcard) {
+        continue;
+      }
+      if (!key.empty()) {
+        key += getSeparator();
+      }
+      key += *child.first;
+      self(child.second, wildcard == PathPattern::ANY_DEPTH ? segment : segment + 1, self);
+      key.resize(length);
+    }
+  };
+  walk(*root, 0, walk);
+  return map;
+}
+
+void TreeBackend::visitChildren(const std::string& path, const std::function<void(std::string_view)>& visit)
+{
+  auto tree = getTree();
+  for (const auto& child : getNode(*tree, path).children) {
+    visit(*child.second.value);
+  }
+}
+
+std::vector<std::string> TreeBackend::listKeys(const std::string& path, bool recursive)
+{
+  std::vector<std::string> keys;
+  auto tree = getTree();
+  auto root = tree->find(addPrefix(path), getSeparator());
+  if (root == nullptr) {
+    return keys;
+  }
+  std::string key;
+  auto walk = [&](const InternedTree::Node& node, auto& self) -> void {
+    auto length = key.size();
+    for (const auto& child : node.children) {
+      if (!key.empty()) {
+        key += getSeparator();
+      }
+      key += *child.first;
+      if (recursive && !child.second.children.empty()) {
+        self(child.second, self);
+      } else if (!key.empty()) {
+        // Elements of a top-level array have no name
+        keys.push_back(key);
+      }
+      key.resize(length);
+    }
+  };
+  walk(*root, walk);
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+MemoryUsage TreeBackend::memoryUsage()
+{
+  std::lock_guard<std::mutex> lock(mSharedMapsMutex);
+  auto usage = getTree()->getMemoryUsage();
+  usage.caches = footprint(mSharedMaps) - sizeof(mSharedMaps);
+  return usage;
+}
+
+std::shared_ptr<const KeyValueMap> TreeBackend::getRecursiveMapShared(const std::string& path)
+{
+  // A prefix with an empty path names the same subtree as the prefix alone
+  auto key = addPrefix(path);
+  if (!key.empty() && key.back() == getSeparator()) {
+    key.pop_back();
+  }
+  std::lock_guard<std::mutex> lock(mSharedMapsMutex);
+  auto& map = mSharedMaps[key];
+  if (!map) {
+    map = std::make_shared<const KeyValueMap>(getRecursiveMap(path));
+  }
+  return map;
+}
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
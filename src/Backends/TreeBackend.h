@@ -0,0 +1,105 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file TreeBackend.h
+/// \brief Base class for backends holding all values in memory in a tree
+///
+
+#ifndef O2_CONFIGURATION_BACKENDS_TREEBACKEND_H_
+#define O2_CONFIGURATION_BACKENDS_TREEBACKEND_H_
+
+#include "BackendBase.h"
+#include "InternedTree.h"
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <boost/property_tree/ptree.hpp>
+
+namespace o2
+{
+namespace configuration
+{
+namespace backends
+{
+
+/// Base class for backends which load all values at once, e.g. from a file
+class TreeBackend : public BackendBase
+{
+  public:
+    /// \param resource Memory resource each loaded tree allocates its arena from
+    explicit TreeBackend(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    virtual ~TreeBackend() = default;
+    virtual boost::optional<std::string> getString(const std::string& path) override;
+    virtual boost::property_tree::ptree getRecursive(const std::string& path) override;
+    virtual KeyValueMap getRecursiveMap(const std::string& path) override;
+
+    /// Walks only the branches of the tree the pattern can match
+    virtual KeyValueMap getMatching(const std::string& pattern) override;
+
+    /// Walks the tree without copying values
+    virtual std::vector<std::string> listKeys(const std::string& path, bool recursive) override;
+
+    /// Memoised per path, the same map is returned until the tree is replaced
+    virtual std::shared_ptr<const KeyValueMap> getRecursiveMapShared(const std::string& path) override;
+
+    /// Tree as taken from the memory resource, shared maps as caches
+    virtual MemoryUsage memoryUsage() override;
+
+    /// Reports what deduplication of keys and values saved
+    StringPool::Statistics getInternStatistics() const
+    {
+      return getTree()->getStatistics();
+    }
+
+  protected:
+    /// Reads the interned values in place
+    virtual void visitChildren(const std::string& path, const std::function<void(std::string_view)>& visit) override;
+
+    /// Replaces the values, e.g. after (re)loading, and drops results derived from the previous ones
+    /// \param tree New values, copied into the interned tree
+    void setTree(const boost::property_tree::ptree& tree);
+
+    /// Replaces the values with an already interned tree, which may be shared with other backends
+    void setTree(std::shared_ptr<const InternedTree> tree);
+
+  private:
+    /// Returns the current values, which stay valid while the returned pointer is held, also after setTree()
+    std::shared_ptr<const InternedTree> getTree() const
+    {
+      return std::atomic_load(&mTree);
+    }
+
+    /// Finds a node, throws ptree_bad_path like ptree::get_child() when missing
+    /// \param tree Values to search, held by the caller
+    /// \param path Path of the node, without prefix
+    const InternedTree::Node& getNode(const InternedTree& tree, const std::string& path);
+
+    /// Upstream of the arenas of loaded trees
+    std::pmr::memory_resource* mResource;
+
+    /// Loaded values, with keys and values interned; accessed atomically, as setTree() may run during lookups
+    std::shared_ptr<const InternedTree> mTree;
+
+    /// Results of getRecursiveMapShared(), by path including prefix
+    std::unordered_map<std::string, std::shared_ptr<const KeyValueMap>> mSharedMaps;
+
+    /// Guards memoised results
+    std::mutex mSharedMapsMutex;
+};
+
+} // namespace backends
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_BACKENDS_TREEBACKEND_H_
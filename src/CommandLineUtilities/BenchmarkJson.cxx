@@ -0,0 +1,57 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file BenchmarkJson.cxx
+/// \brief Measures JSON parsing throughput for different numbers of threads
+///
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "../Backends/Json/JsonParallelParser.h"
+#include <boost/program_options.hpp>
+
+int main(int argc, char *argv[]) {
+  std::string file;
+  std::vector<unsigned> threads;
+  unsigned repeat;
+  boost::program_options::options_description desc("Measures JSON parsing throughput.");
+  desc.add_options()
+    ("file", boost::program_options::value<std::string>(&file)->required(), "JSON file")
+    ("threads", boost::program_options::value<std::vector<unsigned>>(&threads)->multitoken()
+      ->default_value({1, 4, 16}, "1 4 16"), "Numbers of threads to measure")
+    ("repeat", boost::program_options::value<unsigned>(&repeat)->default_value(5), "Parses per measurement")
+  ;
+
+  boost::program_options::variables_map vm;
+  boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+  boost::program_options::notify(vm);
+
+  std::ifstream stream(file, std::ios::binary);
+  std::stringstream buffer;
+  buffer << stream.rdbuf();
+  auto data = buffer.str();
+  std::cout << "File size: " << data.size() << " bytes" << std::endl;
+
+  for (auto count : threads) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeat; i++) {
+      boost::property_tree::ptree tree;
+      o2::configuration::backends::parseJson(data.data(), data.size(), tree, count);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Threads: " << count << ", " << elapsed.count() * 1000 / repeat << " ms per parse, "
+              << data.size() * repeat / elapsed.count() / (1024 * 1024) << " MB/s" << std::endl;
+  }
+}
@@ -14,8 +14,10 @@
 /// \author Adam Wegrzynek <adam.wegrzynek@cern.ch>
 ///
 
+#include <iostream>
 #include "Configuration/ConfigurationFactory.h"
 #include "../Backends/Json/JsonBackend.h"
+#include "Sync.h"
 #include <boost/program_options.hpp>
 
 int main(int argc, char *argv[]) {
@@ -24,12 +26,16 @@ int main(int argc, char *argv[]) {
   desc.add_options()
     ("src", boost::program_options::value<std::string>(&sourceUri)->required(), "Source URI")
     ("dest", boost::program_options::value<std::string>(&destinationUri)->required(), "Destination URI")
+    ("sync", boost::program_options::bool_switch(), "Write only values that were added, changed or removed")
+    ("dry-run", boost::program_options::bool_switch(), "Report differences without writing (implies --sync)")
   ;
 
   boost::program_options::variables_map vm;
   boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
   boost::program_options::notify(vm);
 
+  bool dryRun = vm["dry-run"].as<bool>();
+  bool syncMode = vm["sync"].as<bool>() || dryRun;
 
   using namespace o2::configuration;
   auto source = ConfigurationFactory::getConfiguration(sourceUri);
@@ -37,11 +43,22 @@ int main(int argc, char *argv[]) {
 
   // Workaround for writing JSON
   if (destinationUri.substr(0,4) == "json") {
+    if (syncMode) {
+      std::cerr << "Sync mode is not supported for JSON destination" << std::endl;
+      return 1;
+    }
     auto destination = new backends::JsonBackend("json://");
     destination->putRecursive(destinationUri.substr(5), values);
     return 0;
   }
 
   auto destination = ConfigurationFactory::getConfiguration(destinationUri);
+  if (syncMode) {
+    auto statistics = sync::sync(values, *destination, dryRun, std::cout);
+    std::cout << "Added: " << statistics.added << ", changed: " << statistics.changed << ", removed: " << statistics.removed
+              << ", unchanged: " << statistics.unchanged << std::endl;
+    std::cout << (dryRun ? "Bytes to write: " : "Bytes written: ") << statistics.bytes << std::endl;
+    return 0;
+  }
   destination->putRecursive("", values);
 }
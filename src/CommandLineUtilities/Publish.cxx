@@ -0,0 +1,80 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file Publish.cxx
+/// \brief Publishes a configuration into shared memory for processes on the node
+///
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <thread>
+#include "Configuration/ConfigurationFactory.h"
+#include "Configuration/SharedMemoryPublisher.h"
+#include <boost/program_options.hpp>
+
+namespace {
+
+std::atomic<bool> stopped(false);
+
+void stop(int)
+{
+  stopped = true;
+}
+
+} // Anonymous namespace
+
+int main(int argc, char *argv[]) {
+  std::string sourceUri, name;
+  unsigned interval;
+  boost::program_options::options_description desc("Publishes a configuration into shared memory, to be read with shm://name, until terminated.");
+  desc.add_options()
+    ("src", boost::program_options::value<std::string>(&sourceUri)->required(), "Source URI")
+    ("name", boost::program_options::value<std::string>(&name)->required(), "Name of the snapshot")
+    ("interval", boost::program_options::value<unsigned>(&interval)->default_value(0),
+      "Seconds between checks of the source for changes, 0 to publish only once")
+  ;
+
+  boost::program_options::variables_map vm;
+  boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+  boost::program_options::notify(vm);
+
+  std::signal(SIGINT, stop);
+  std::signal(SIGTERM, stop);
+
+  using namespace o2::configuration;
+  auto source = ConfigurationFactory::getConfiguration(sourceUri);
+  SharedMemoryPublisher publisher(name);
+  auto values = source->getRecursive("");
+  std::cout << "Published version " << publisher.publish(values) << std::endl;
+
+  // The published values are removed when the publisher exits, readers pick up versions of a restarted one
+  auto nextCheck = std::chrono::steady_clock::now() + std::chrono::seconds(interval);
+  while (!stopped) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (interval == 0 || std::chrono::steady_clock::now() < nextCheck) {
+      continue;
+    }
+    nextCheck += std::chrono::seconds(interval);
+    try {
+      source->refresh();
+      auto latest = source->getRecursive("");
+      if (latest != values) {
+        values = std::move(latest);
+        std::cout << "Published version " << publisher.publish(values) << std::endl;
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Unable to read source: " << e.what() << std::endl;
+    }
+  }
+}
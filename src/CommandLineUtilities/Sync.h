@@ -0,0 +1,136 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file Sync.h
+/// \brief Writing only the differences between a tree and a destination, used by o2-configuration-convert
+///
+
+#ifndef O2_CONFIGURATION_COMMANDLINEUTILITIES_SYNC_H_
+#define O2_CONFIGURATION_COMMANDLINEUTILITIES_SYNC_H_
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Configuration/ConfigurationInterface.h"
+
+namespace o2
+{
+namespace configuration
+{
+namespace sync
+{
+
+using boost::property_tree::ptree;
+
+/// Counts of keys compared by sync()
+struct Statistics {
+  std::size_t added = 0;
+  std::size_t changed = 0;
+  std::size_t removed = 0;
+  std::size_t unchanged = 0;
+
+  /// Bytes of keys and values written
+  std::size_t bytes = 0;
+};
+
+/// Flattens tree leaves into a sorted key-value map, array elements are keyed by their position
+/// \param tree Tree to flatten
+/// \param skipFolders Whether to skip empty nodes without a name, which are Consul folder keys read back
+inline std::map<std::string, std::string> flatten(const ptree& tree, bool skipFolders)
+{
+  std::map<std::string, std::string> map;
+  std::function<void(const ptree&, const std::string&)> parse = [&](const ptree& node, const std::string& key) {
+    if (node.empty()) {
+      if (!key.empty()) {
+        map[key] = node.data();
+      }
+      return;
+    }
+    std::size_t position = 0;
+    for (auto const& it : node) {
+      if (skipFolders && it.first.empty() && it.second.empty() && it.second.data().empty()) {
+        continue;
+      }
+      // Positions count all elements, as putRecursive() stores them
+      auto name = it.first.empty() ? std::to_string(position) : it.first;
+      position++;
+      parse(it.second, key.empty() ? name : key + '.' + name);
+    }
+  };
+  parse(tree, "");
+  return map;
+}
+
+/// Writes to the destination only values that differ from the source
+/// \param values Values of the source
+/// \param destination Destination to update
+/// \param dryRun Whether to only compare, without writing
+/// \param log Receives a line per added, changed or removed key
+inline Statistics sync(const ptree& values, ConfigurationInterface& destination, bool dryRun, std::ostream& log)
+{
+  auto source = flatten(values, false);
+  auto current = flatten(destination.getRecursive(""), true);
+
+  ptree changes;
+  std::vector<std::string> removed;
+  Statistics statistics;
+
+  // Both maps are sorted, so a single merge pass yields the difference
+  auto src = source.begin();
+  auto dest = current.begin();
+  while (src != source.end() || dest != current.end()) {
+    if (dest == current.end() || (src != source.end() && src->first < dest->first)) {
+      log << "+ " << src->first << std::endl;
+      changes.put(src->first, src->second);
+      statistics.bytes += src->first.size() + src->second.size();
+      statistics.added++;
+      ++src;
+    } else if (src == source.end() || dest->first < src->first) {
+      log << "- " << dest->first << std::endl;
+      removed.push_back(dest->first);
+      statistics.bytes += dest->first.size();
+      ++dest;
+    } else {
+      if (src->second != dest->second) {
+        log << "~ " << src->first << std::endl;
+        changes.put(src->first, src->second);
+        statistics.bytes += src->first.size() + src->second.size();
+        statistics.changed++;
+      } else {
+        statistics.unchanged++;
+      }
+      ++src;
+      ++dest;
+    }
+  }
+  statistics.removed = removed.size();
+  if (dryRun) {
+    return statistics;
+  }
+
+  if (!changes.empty()) {
+    destination.putRecursive("", changes);
+  }
+  for (const auto& key : removed) {
+    destination.erase(key);
+  }
+  destination.flush();
+  return statistics;
+}
+
+} // namespace sync
+} // namespace configuration
+} // namespace o2
+
+#endif // O2_CONFIGURATION_COMMANDLINEUTILITIES_SYNC_H_
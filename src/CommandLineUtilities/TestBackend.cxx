@@ -14,8 +14,11 @@
 /// \author Adam Wegrzynek <adam.wegrzynek@cern.ch>
 ///
 
+#include <chrono>
+#include <iomanip>
 #include <iostream>
 #include "Configuration/ConfigurationFactory.h"
+#include "../Backends/TreeBackend.h"
 #include <boost/program_options.hpp>
 
 int main(int argc, char *argv[]) {
@@ -24,6 +27,9 @@ int main(int argc, char *argv[]) {
   desc.add_options()
     ("backend", boost::program_options::value<std::string>(&uri)->required(), "Backend URI")
     ("get-key", boost::program_options::value<std::string>(), "Key to get a value (optional)")
+    ("intern-stats", boost::program_options::bool_switch(), "Print what deduplication of keys and values saved (file backends only)")
+    ("memory", boost::program_options::bool_switch(), "Print memory held by the backend")
+    ("profile", boost::program_options::bool_switch(), "Print time spent in each phase of creating the backend, and of the first lookup with --get-key")
   ;
 
   boost::program_options::variables_map vm;
@@ -32,10 +38,37 @@ int main(int argc, char *argv[]) {
 
   using namespace o2::configuration;
   std::cout << "Testing backned: " << uri << std::endl;
+  auto start = std::chrono::steady_clock::now();
   auto source = ConfigurationFactory::getConfiguration(uri);
+  auto created = std::chrono::steady_clock::now() - start;
   if (vm.count("get-key")) {
     std::string key = vm["get-key"].as<std::string>();
     std::cout << "Reading from key: " << key << std::endl;
     std::cout << "Value read: " << source->get<std::string>(key) << std::endl;
   }
+  if (vm["intern-stats"].as<bool>()) {
+    auto tree = dynamic_cast<backends::TreeBackend*>(source.get());
+    if (tree == nullptr) {
+      std::cerr << "Backend does not intern its values" << std::endl;
+      return 1;
+    }
+    const auto& stats = tree->getInternStatistics();
+    std::cout << "Strings: " << stats.references << ", distinct: " << stats.strings << std::endl;
+    std::cout << "Bytes without interning: " << stats.referencedBytes << ", interned: " << stats.pooledBytes << std::endl;
+  }
+  if (vm["profile"].as<bool>()) {
+    auto print = [](const std::string& name, std::chrono::nanoseconds duration) {
+      std::cout << std::left << std::setw(10) << name << std::right << std::setw(12) << std::fixed
+                << std::setprecision(3) << duration.count() / 1e6 << " ms" << std::endl;
+    };
+    for (const auto& phase : source->getStartupProfile()) {
+      print(phase.name, phase.duration);
+    }
+    print("creation", created);
+  }
+  if (vm["memory"].as<bool>()) {
+    auto usage = source->memoryUsage();
+    std::cout << "Bytes of keys: " << usage.keys << ", values: " << usage.values << ", structure: " << usage.structure
+              << ", caches: " << usage.caches << ", total: " << usage.total() << std::endl;
+  }
 }
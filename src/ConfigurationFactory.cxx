@@ -19,13 +19,19 @@
 #include "Backends/String/StringBackend.h"
 #include <Backends/Ini/IniBackend.h>
 #include <Backends/Apricot/ApricotBackend.h>
+#include <Backends/Directory/DirectoryBackend.h>
+#include <Backends/SharedMemory/SharedMemoryBackend.h>
 #include <functional>
 #include <map>
+#include <set>
+#include <sstream>
 #include <stdexcept>
+#include <vector>
 #include <filesystem>
 
 #ifdef FLP_CONFIGURATION_BACKEND_CONSUL_ENABLED
 # include "Backends/Consul/ConsulBackend.h"
+# include "Backends/Consul/ConsulBlobBackend.h"
 #endif
 #include "UriParser/UriParser.h"
 
@@ -40,6 +46,7 @@ using UniqueConfiguration = std::unique_ptr<ConfigurationInterface>;
 /// Make sure to support relative and absolute paths
 auto verifyFilePath(const http::url& uri) -> std::string
 {
+  auto checking = backends::PhaseProfiler::measure("files");
   namespace fs = std::filesystem;
   auto relative = uri.host + uri.path;
   auto absolute = "/" + relative;
@@ -54,75 +61,166 @@ auto verifyFilePath(const http::url& uri) -> std::string
   return {};
 }
 
-auto getIni(const http::url& uri) -> UniqueConfiguration
+/// Splits URI query, e.g. "key1=value1&key2=value2", into key-value pairs
+auto parseQuery(const std::string& search) -> std::map<std::string, std::string>
 {
-  return std::make_unique<backends::IniBackend>(verifyFilePath(uri));
+  std::map<std::string, std::string> query;
+  std::istringstream ss(search);
+  std::string parameter;
+  while (std::getline(ss, parameter, '&')) {
+    auto equals = parameter.find('=');
+    if (equals == std::string::npos) {
+      query[parameter] = "";
+    } else {
+      query[parameter.substr(0, equals)] = parameter.substr(equals + 1);
+    }
+  }
+  return query;
+}
+
+/// Splits a list of replica endpoints, e.g. "host1:8500,host2:8500", into hosts and ports
+auto parseReplicas(const std::string& list) -> std::vector<std::pair<std::string, int>>
+{
+  std::vector<std::pair<std::string, int>> replicas;
+  std::istringstream ss(list);
+  std::string endpoint;
+  while (std::getline(ss, endpoint, ',')) {
+    auto colon = endpoint.rfind(':');
+    if (colon == std::string::npos) {
+      throw std::runtime_error("Replica endpoint without port: " + endpoint);
+    }
+    replicas.emplace_back(endpoint.substr(0, colon), std::stoi(endpoint.substr(colon + 1)));
+  }
+  return replicas;
+}
+
+/// Reads a duration in milliseconds from a URI parameter
+auto parseMilliseconds(std::map<std::string, std::string>& query, const std::string& name, unsigned long defaultValue = 0)
+  -> std::chrono::milliseconds
+{
+  return std::chrono::milliseconds(query.count(name) ? std::stoul(query[name]) : defaultValue);
+}
+
+/// Reads retries and hedging of remote backends from URI parameters
+auto parseRetryPolicy(std::map<std::string, std::string>& query) -> backends::RetryPolicy
+{
+  backends::RetryPolicy policy;
+  if (query.count("retries")) {
+    policy.retries = std::stoul(query["retries"]);
+  }
+  policy.backoff = parseMilliseconds(query, "backoff", policy.backoff.count());
+  policy.maxBackoff = parseMilliseconds(query, "maxBackoff", policy.maxBackoff.count());
+  if (query.count("hedge")) {
+    policy.hedgePercentile = std::stod(query["hedge"]);
+  }
+  return policy;
+}
+
+auto getIni(const http::url& uri, std::pmr::memory_resource* resource) -> UniqueConfiguration
+{
+  return std::make_unique<backends::IniBackend>(verifyFilePath(uri), false, resource);
 }
 
-auto getJson(const http::url& uri) -> UniqueConfiguration
+auto getJson(const http::url& uri, std::pmr::memory_resource* resource) -> UniqueConfiguration
 {
-  auto backend = std::make_unique<backends::JsonBackend>(verifyFilePath(uri));
+  auto backend = std::make_unique<backends::JsonBackend>(verifyFilePath(uri), resource);
   backend->readJsonFile();
   return backend;
 }
 
-auto getString(const http::url& uri) -> UniqueConfiguration
+auto getDirectory(const http::url& uri, std::pmr::memory_resource* resource) -> UniqueConfiguration
+{
+  return std::make_unique<backends::DirectoryBackend>(verifyFilePath(uri), resource);
+}
+
+auto getSharedMemory(const http::url& uri, std::pmr::memory_resource* /*resource*/) -> UniqueConfiguration
+{
+  return std::make_unique<backends::SharedMemoryBackend>(uri.host + uri.path);
+}
+
+auto getString(const http::url& uri, std::pmr::memory_resource* resource) -> UniqueConfiguration
 {
   auto path = uri.host + uri.path;
-  auto backend = std::make_unique<backends::StringBackend>(path);
+  auto backend = std::make_unique<backends::StringBackend>(path, resource);
   return backend;
 }
 
-auto getApricot(const http::url& uri) -> UniqueConfiguration
+auto getApricot(const http::url& uri, std::pmr::memory_resource* /*resource*/) -> UniqueConfiguration
 {
   auto apricot = std::make_unique<backends::ApricotBackend>(uri.host, uri.port);
   if (!uri.path.empty()) {
     apricot->setBasePrefix(uri.path.substr(1));
   }
-  if (!uri.search.empty()) {
-    apricot->setParams("?" + uri.search + "&process=true");
-  } else {
-    apricot->setParams("?process=true");
+  auto query = parseQuery(uri.search);
+  if (query.count("poolSize")) {
+    apricot->setPoolSize(std::stoul(query["poolSize"]));
+  }
+  for (const auto& replica : parseReplicas(query["replicas"])) {
+    apricot->addReplica(replica.first, replica.second);
+  }
+  apricot->setRetryPolicy(parseRetryPolicy(query));
+  apricot->setTimeouts(parseMilliseconds(query, "connectTimeout", 3000), parseMilliseconds(query, "timeout", 3000));
+  apricot->setStaleTtl(parseMilliseconds(query, "softTtl"), parseMilliseconds(query, "hardTtl"));
+
+  // Parameters interpreted by the library are not forwarded to the server
+  static const std::set<std::string> libraryParameters = {
+    "poolSize", "replicas", "retries", "backoff", "maxBackoff", "hedge", "connectTimeout", "timeout", "softTtl", "hardTtl"
+  };
+  std::string params = "?";
+  std::istringstream ss(uri.search);
+  std::string parameter;
+  while (std::getline(ss, parameter, '&')) {
+    if (!libraryParameters.count(parameter.substr(0, parameter.find('=')))) {
+      params += parameter + "&";
+    }
   }
+  apricot->setParams(params + "process=true");
   return apricot;
 }
 
 #ifdef FLP_CONFIGURATION_BACKEND_CONSUL_ENABLED
-auto getConsul(const http::url& uri) -> UniqueConfiguration
+auto getConsul(const http::url& uri, std::pmr::memory_resource* /*resource*/) -> UniqueConfiguration
 {
   auto consul = std::make_unique<backends::ConsulBackend>(uri.host, uri.port);
   if (!uri.path.empty()) {
     consul->setBasePrefix(uri.path.substr(1));
   }
+  auto query = parseQuery(uri.search);
+  consul->setWriteBehind(query["writeBehind"] == "true");
+  consul->setKeyFilter(query["keyFilter"] == "true");
+  if (query.count("pageSize")) {
+    consul->setPageSize(std::stoul(query["pageSize"]));
+  }
+  for (const auto& replica : parseReplicas(query["replicas"])) {
+    consul->addReplica(replica.first, replica.second);
+  }
+  consul->setRetryPolicy(parseRetryPolicy(query));
+  consul->setStaleTtl(parseMilliseconds(query, "softTtl"), parseMilliseconds(query, "hardTtl"));
   return consul;
 }
 
-auto getConsulIni(const http::url& uri) -> UniqueConfiguration
+auto getConsulIni(const http::url& uri, std::pmr::memory_resource* resource) -> UniqueConfiguration
 {
-  auto consul = std::make_unique<backends::ConsulBackend>(uri.host, uri.port);
-  auto iniFile = consul->get<std::string>(uri.path.substr(1));
-  return std::make_unique<backends::IniBackend>(iniFile, true);
+  return std::make_unique<backends::ConsulBlobBackend>(uri.host, uri.port, uri.path.substr(1),
+                                                      backends::ConsulBlobBackend::Format::Ini, resource);
 }
 
-auto getConsulJson(const http::url& uri) -> UniqueConfiguration
+auto getConsulJson(const http::url& uri, std::pmr::memory_resource* resource) -> UniqueConfiguration
 {
-  auto consul = std::make_unique<backends::ConsulBackend>(uri.host, uri.port);
-  auto jsonFile = consul->get<std::string>(uri.path.substr(1));
-  auto backend = std::make_unique<backends::JsonBackend>(jsonFile);
-  backend->readJsonFile(true);
-  return backend;
+  return std::make_unique<backends::ConsulBlobBackend>(uri.host, uri.port, uri.path.substr(1),
+                                                      backends::ConsulBlobBackend::Format::Json, resource);
 }
 
 #else
-auto getConsul(const http::url& /*uri*/) -> UniqueConfiguration
+auto getConsul(const http::url& /*uri*/, std::pmr::memory_resource* /*resource*/) -> UniqueConfiguration
 {
   throw std::runtime_error("Back-end 'consul' not enabled");
 }
-auto getConsulIni(const http::url& /*uri*/) -> UniqueConfiguration
+auto getConsulIni(const http::url& /*uri*/, std::pmr::memory_resource* /*resource*/) -> UniqueConfiguration
 {
   throw std::runtime_error("Back-end 'consul-ini' not enabled");
 }
-auto getConsulJson(const http::url& /*uri*/) -> UniqueConfiguration
+auto getConsulJson(const http::url& /*uri*/, std::pmr::memory_resource* /*resource*/) -> UniqueConfiguration
 {
   throw std::runtime_error("Back-end 'consul-json' not enabled");
 }
@@ -131,30 +229,65 @@ auto getConsulJson(const http::url& /*uri*/) -> UniqueConfiguration
 
 auto ConfigurationFactory::getConfiguration(const std::string& uri) -> UniqueConfiguration
 {
-  auto string = uri; // The http library needs a non-const string for some reason
-  http::url parsedUrl = http::ParseHttpUrl(string);
+  return getConfiguration(uri, std::pmr::get_default_resource());
+}
+
+auto ConfigurationFactory::getConfiguration(const std::string& uri, std::pmr::memory_resource* resource)
+  -> UniqueConfiguration
+{
+  // Phases are recorded before the backend exists, and handed over to it
+  backends::PhaseProfiler profiler;
+  backends::PhaseProfiler::Recording recording(profiler);
+  http::url parsedUrl;
+  {
+    auto parsing = backends::PhaseProfiler::measure("uri");
+    auto string = uri; // The http library needs a non-const string for some reason
+    parsedUrl = http::ParseHttpUrl(string);
+  }
 
   if (parsedUrl.protocol.empty()) {
     throw std::runtime_error("Ill-formed URI");
   }
 
   static const std::map<std::string,
-                        std::function<UniqueConfiguration(const http::url&)>>
+                        std::function<UniqueConfiguration(const http::url&, std::pmr::memory_resource*)>>
     map = {{"ini", getIni},
            {"json", getJson},
            {"consul", getConsul},
            {"consul-ini", getConsulIni},
            {"consul-json", getConsulJson},
            {"str", getString},
+           {"dir", getDirectory},
+           {"shm", getSharedMemory},
            {"apricot", getApricot}};
 
   auto iterator = map.find(parsedUrl.protocol);
   if (iterator != map.end()) {
-    return iterator->second(parsedUrl);
+    auto configuration = iterator->second(parsedUrl, resource);
+    if (auto backend = dynamic_cast<BackendBase*>(configuration.get())) {
+      backend->addStartupPhases(profiler);
+    }
+    return configuration;
   } else {
     throw std::runtime_error("Unrecognized backend");
   }
 }
 
+auto ConfigurationFactory::getConfiguration(const std::string& uri, const std::vector<std::string>& prefetch,
+  std::chrono::milliseconds timeout) -> UniqueConfiguration
+{
+  auto configuration = getConfiguration(uri);
+  backends::PhaseProfiler profiler;
+  {
+    backends::PhaseProfiler::Recording recording(profiler);
+    auto prefetching = backends::PhaseProfiler::measure("prefetch");
+    configuration->prefetch(prefetch, timeout);
+  }
+  if (auto backend = dynamic_cast<BackendBase*>(configuration.get())) {
+    backend->addStartupPhases(profiler);
+  }
+  return configuration;
+}
+
 } // namespace configuration
 } // namespace o2
@@ -15,10 +15,50 @@
 /// \author Pascal Boeschoten, CERN
 
 #include "Configuration/ConfigurationInterface.h"
+#include "Backends/PathPattern.h"
+#include <algorithm>
 #include <boost/lexical_cast.hpp>
+#include <charconv>
 
 namespace o2 {
 namespace configuration {
+namespace {
+
+/// Converts a value to a number, without locale or stream overhead
+template <typename T>
+void parseNumber(std::string_view data, T &value, std::size_t index,
+                 const std::string &path) {
+  auto result = std::from_chars(data.data(), data.data() + data.size(), value);
+  if (result.ec != std::errc() || result.ptr != data.data() + data.size()) {
+    throw std::runtime_error("Could not parse element " +
+                             std::to_string(index) + " of: " + path);
+  }
+}
+
+/// Returns a visitor appending the values of children to a vector
+template <typename T>
+auto appendNumbers(std::vector<T> &values, const std::string &path) {
+  return [&values, &path](std::string_view data) {
+    values.emplace_back();
+    parseNumber(data, values.back(), values.size() - 1, path);
+  };
+}
+
+/// Returns a visitor writing the values of children to memory of the caller
+template <typename T>
+auto writeNumbers(T *values, std::size_t size, std::size_t &count,
+                  const std::string &path) {
+  return [values, size, &count, &path](std::string_view data) {
+    if (count == size) {
+      throw std::runtime_error("More than " + std::to_string(size) +
+                               " elements in: " + path);
+    }
+    parseNumber(data, values[count], count, path);
+    count++;
+  };
+}
+
+} // Anonymous namespace
 
 ConfigurationInterface::~ConfigurationInterface() {}
 
@@ -47,6 +87,104 @@ void ConfigurationInterface::putRecursive(
       "Recursive put not supported in the selected backend");
 }
 
+void ConfigurationInterface::erase(const std::string & /* path*/) {
+  throw std::runtime_error("Erase not supported in the selected backend");
+}
+
+void ConfigurationInterface::flush() {}
+
+void ConfigurationInterface::prefetch(
+    const std::vector<std::string> & /* paths*/,
+    std::chrono::milliseconds /* timeout*/) {}
+
+void ConfigurationInterface::refresh() {}
+
+bool ConfigurationInterface::isHealthy() { return true; }
+
+MemoryUsage ConfigurationInterface::memoryUsage() { return {}; }
+
+std::vector<Phase> ConfigurationInterface::getStartupProfile() { return {}; }
+
+KeyValueMap ConfigurationInterface::getMatching(const std::string &pattern) {
+  return filterMatching(pattern, '.');
+}
+
+KeyValueMap ConfigurationInterface::filterMatching(const std::string &pattern,
+                                                   char separator) {
+  // Values under the literal prefix of the pattern are filtered
+  backends::PathPattern matcher(pattern, separator);
+  auto prefix = matcher.getLiteralPrefix();
+  KeyValueMap candidates;
+  try {
+    candidates = getRecursiveMap(prefix);
+  } catch (const boost::property_tree::ptree_bad_path &) {
+    return {};
+  }
+  KeyValueMap matching;
+  for (auto &candidate : candidates) {
+    auto path = prefix.empty() || candidate.first.empty()
+                    ? prefix + candidate.first
+                    : prefix + separator + candidate.first;
+    if (matcher.matches(path)) {
+      matching.emplace(std::move(path), std::move(candidate.second));
+    }
+  }
+  return matching;
+}
+
+void ConfigurationInterface::visitChildren(
+    const std::string &path,
+    const std::function<void(std::string_view)> &visit) {
+  for (const auto &child : getRecursive(path)) {
+    visit(child.second.data());
+  }
+}
+
+std::vector<std::string>
+ConfigurationInterface::listKeys(const std::string &path, bool recursive) {
+  return listTreeKeys(path, recursive, '.');
+}
+
+std::vector<std::string>
+ConfigurationInterface::listTreeKeys(const std::string &path, bool recursive,
+                                     char separator) {
+  std::vector<std::string> keys;
+  boost::property_tree::ptree tree;
+  try {
+    tree = getRecursive(path);
+  } catch (const boost::property_tree::ptree_bad_path &) {
+    return {};
+  }
+  std::string key;
+  std::function<void(const boost::property_tree::ptree &)> walk =
+      [&](const boost::property_tree::ptree &node) {
+        auto length = key.size();
+        for (const auto &child : node) {
+          if (!key.empty()) {
+            key += separator;
+          }
+          key += child.first;
+          if (!recursive || child.second.empty()) {
+            keys.push_back(key);
+          } else {
+            walk(child.second);
+          }
+          key.resize(length);
+        }
+      };
+  walk(tree);
+  // Elements of a top-level array have no name
+  keys.erase(std::remove(keys.begin(), keys.end(), std::string()), keys.end());
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+std::shared_ptr<const KeyValueMap>
+ConfigurationInterface::getRecursiveMapShared(const std::string &path) {
+  return std::make_shared<const KeyValueMap>(getRecursiveMap(path));
+}
+
 template <> std::string ConfigurationInterface::get(const std::string &path) {
   auto optional = getString(path);
   return (optional != boost::none)
@@ -114,5 +252,61 @@ auto ConfigurationInterface::get(const std::string &path,
   return defaultValue;
 }
 
+template <> std::vector<int> ConfigurationInterface::getArray(const std::string &path) {
+  std::vector<int> values;
+  visitChildren(path, appendNumbers(values, path));
+  return values;
+}
+
+template <>
+std::size_t ConfigurationInterface::getArray(const std::string &path,
+                                             int *values, std::size_t size) {
+  std::size_t count = 0;
+  visitChildren(path, writeNumbers(values, size, count, path));
+  return count;
+}
+
+template <> std::vector<long> ConfigurationInterface::getArray(const std::string &path) {
+  std::vector<long> values;
+  visitChildren(path, appendNumbers(values, path));
+  return values;
+}
+
+template <>
+std::size_t ConfigurationInterface::getArray(const std::string &path,
+                                             long *values, std::size_t size) {
+  std::size_t count = 0;
+  visitChildren(path, writeNumbers(values, size, count, path));
+  return count;
+}
+
+template <> std::vector<float> ConfigurationInterface::getArray(const std::string &path) {
+  std::vector<float> values;
+  visitChildren(path, appendNumbers(values, path));
+  return values;
+}
+
+template <>
+std::size_t ConfigurationInterface::getArray(const std::string &path,
+                                             float *values, std::size_t size) {
+  std::size_t count = 0;
+  visitChildren(path, writeNumbers(values, size, count, path));
+  return count;
+}
+
+template <> std::vector<double> ConfigurationInterface::getArray(const std::string &path) {
+  std::vector<double> values;
+  visitChildren(path, appendNumbers(values, path));
+  return values;
+}
+
+template <>
+std::size_t ConfigurationInterface::getArray(const std::string &path,
+                                             double *values, std::size_t size) {
+  std::size_t count = 0;
+  visitChildren(path, writeNumbers(values, size, count, path));
+  return count;
+}
+
 } // namespace configuration
 } // namespace o2
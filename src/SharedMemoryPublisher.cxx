@@ -0,0 +1,149 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file SharedMemoryPublisher.cxx
+/// \brief Publishes configuration snapshots to processes on the same node
+///
+
+#include "Configuration/SharedMemoryPublisher.h"
+#include "Backends/SharedMemory/SharedMemoryLayout.h"
+#include "Backends/SharedMemory/SharedMemorySegment.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace o2
+{
+namespace configuration
+{
+
+using namespace backends;
+
+SharedMemoryPublisher::SharedMemoryPublisher(const std::string& name) : mName(name)
+{
+  if (name.empty() || name.find('/') != std::string::npos) {
+    throw std::runtime_error("Invalid shared memory configuration name: " + name);
+  }
+  mControl = shm::Segment::create(shm::controlName(mName), sizeof(shm::Control));
+  auto control = reinterpret_cast<shm::Control*>(mControl->data());
+  if (control->magic != shm::MAGIC || control->layoutVersion != shm::LAYOUT_VERSION) {
+    new (&control->version) std::atomic<uint64_t>(0);
+    control->layoutVersion = shm::LAYOUT_VERSION;
+    control->magic = shm::MAGIC;
+  }
+}
+
+SharedMemoryPublisher::~SharedMemoryPublisher()
+{
+  // Readers keep the control segment mapped, a new one would hide the versions of the next publisher from them
+  auto version = reinterpret_cast<shm::Control*>(mControl->data())->version.load();
+  if (version > 0) {
+    shm_unlink(shm::dataName(mName, version).c_str());
+  }
+  if (version > 1) {
+    shm_unlink(shm::dataName(mName, version - 1).c_str());
+  }
+}
+
+void SharedMemoryPublisher::remove(const std::string& name)
+{
+  auto control = shm::Segment::open(shm::controlName(name));
+  if (control && control->size() >= sizeof(shm::Control)) {
+    auto version = reinterpret_cast<const shm::Control*>(control->data())->version.load();
+    if (version > 0) {
+      shm_unlink(shm::dataName(name, version).c_str());
+    }
+    if (version > 1) {
+      shm_unlink(shm::dataName(name, version - 1).c_str());
+    }
+  }
+  shm_unlink(shm::controlName(name).c_str());
+}
+
+uint64_t SharedMemoryPublisher::publish(const boost::property_tree::ptree& tree)
+{
+  // Each distinct string is stored once
+  std::string strings;
+  std::unordered_map<std::string, uint32_t> offsets;
+  auto addString = [&](const std::string& string) -> uint32_t {
+    auto inserted = offsets.emplace(string, strings.size());
+    if (inserted.second) {
+      strings += string;
+    }
+    return inserted.first->second;
+  };
+
+  // Breadth-first, so children of each node are next to each other
+  using boost::property_tree::ptree;
+  std::vector<shm::Node> nodes{ { 0, 0, addString(tree.data()), uint32_t(tree.data().size()), 0, 0 } };
+  std::vector<const ptree*> queue{ &tree };
+  for (std::size_t i = 0; i < queue.size(); i++) {
+    nodes[i].children = nodes.size();
+    nodes[i].childCount = queue[i]->size();
+    for (const auto& child : *queue[i]) {
+      nodes.push_back({ addString(child.first), uint32_t(child.first.size()),
+                        addString(child.second.data()), uint32_t(child.second.data().size()), 0, 0 });
+      queue.push_back(&child.second);
+    }
+  }
+  if (strings.size() > std::numeric_limits<uint32_t>::max() || nodes.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Configuration too large for shared memory: " + mName);
+  }
+
+  // Children sorted by key, so that readers find a child by binary search
+  std::vector<uint32_t> index(nodes.size(), 0);
+  auto keyOf = [&](uint32_t node) { return std::string_view(strings).substr(nodes[node].key, nodes[node].keySize); };
+  for (const auto& node : nodes) {
+    auto begin = index.begin() + node.children;
+    auto end = begin + node.childCount;
+    std::iota(begin, end, node.children);
+    std::stable_sort(begin, end, [&](uint32_t a, uint32_t b) { return keyOf(a) < keyOf(b); });
+  }
+
+  auto control = reinterpret_cast<shm::Control*>(mControl->data());
+  auto version = control->version.load() + 1;
+  shm::SnapshotHeader header;
+  header.magic = shm::MAGIC;
+  header.layoutVersion = shm::LAYOUT_VERSION;
+  header.nodeCount = nodes.size();
+  header.version = version;
+  header.indexOffset = sizeof(header) + nodes.size() * sizeof(shm::Node);
+  header.stringsOffset = header.indexOffset + index.size() * sizeof(uint32_t);
+  header.size = header.stringsOffset + strings.size();
+
+  {
+    auto data = shm::Segment::create(shm::dataName(mName, version), header.size);
+    std::memcpy(data->data(), &header, sizeof(header));
+    std::memcpy(data->data() + sizeof(header), nodes.data(), nodes.size() * sizeof(shm::Node));
+    std::memcpy(data->data() + header.indexOffset, index.data(), index.size() * sizeof(uint32_t));
+    std::memcpy(data->data() + header.stringsOffset, strings.data(), strings.size());
+  }
+
+  // Readers pick up the new version from now on, the previous one stays for readers still using it
+  control->version.store(version, std::memory_order_release);
+  if (version > 2) {
+    shm_unlink(shm::dataName(mName, version - 2).c_str());
+  }
+  return version;
+}
+
+uint64_t SharedMemoryPublisher::publish(ConfigurationInterface& configuration)
+{
+  return publish(configuration.getRecursive(""));
+}
+
+} // namespace configuration
+} // namespace o2
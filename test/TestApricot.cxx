@@ -6,6 +6,14 @@
 
 #include "Configuration/ConfigurationFactory.h"
 #include "Configuration/ConfigurationInterface.h"
+#include "../src/Backends/Retry.h"
+#include "../src/Backends/SingleFlight.h"
+#include "../src/Backends/StaleCache.h"
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 #define BOOST_TEST_MODULE ApricotBackend
 #define BOOST_TEST_MAIN
@@ -57,6 +65,36 @@ BOOST_AUTO_TEST_CASE(simpleWithoutProcess)
   BOOST_CHECK_EQUAL(tree.get<std::string>("Barth"), "true");
   BOOST_CHECK_THROW(tree.get<std::string>("bookkeeping.url"), boost::wrapexcept<boost::property_tree::ptree_bad_path>);
 }
+
+BOOST_AUTO_TEST_CASE(prefetch)
+{
+  auto conf = ConfigurationFactory::getConfiguration("apricot://" + APRICOT_ENDPOINT + "/components/qc/ANY/any",
+    {"tpc-full-qcmn"}, std::chrono::milliseconds(3000));
+  BOOST_CHECK_EQUAL(conf->get<std::string>("tpc-full-qcmn.qc.config.database.implementation"), "CCDB");
+  BOOST_CHECK_EQUAL(conf->getRecursive("tpc-full-qcmn").get<std::string>("qc.tasks.RawDigits.moduleName"), "QcTPC");
+}
+
+BOOST_AUTO_TEST_CASE(replicas)
+{
+  // The first endpoint does not listen, requests fail over to the replica
+  auto conf = ConfigurationFactory::getConfiguration("apricot://127.0.0.1:1/components/qc/ANY/any?replicas=" + APRICOT_ENDPOINT +
+    "&retries=2&backoff=10&connectTimeout=500&hedge=95");
+  BOOST_CHECK_EQUAL(conf->getRecursive("tpc-full-qcmn").get<std::string>("qc.config.database.implementation"), "CCDB");
+}
+
+BOOST_AUTO_TEST_CASE(parallelRequests)
+{
+  auto conf = ConfigurationFactory::getConfiguration("apricot://" + APRICOT_ENDPOINT + "/components/qc/ANY/any?poolSize=2");
+  std::vector<std::future<std::string>> results;
+  for (int i = 0; i < 8; i++) {
+    results.push_back(std::async(std::launch::async, [&conf] {
+      return conf->getRecursive("tpc-full-qcmn").get<std::string>("qc.config.database.implementation");
+    }));
+  }
+  for (auto& result : results) {
+    BOOST_CHECK_EQUAL(result.get(), "CCDB");
+  }
+}
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_CASE(Dummy)
@@ -64,4 +102,217 @@ BOOST_AUTO_TEST_CASE(Dummy)
   BOOST_CHECK(true);
 }
 
+BOOST_AUTO_TEST_CASE(RetryBackoff)
+{
+  using namespace o2::configuration::backends;
+  RetryPolicy policy;
+  policy.retries = 3;
+  policy.backoff = std::chrono::milliseconds(4);
+  policy.maxBackoff = std::chrono::milliseconds(10);
+  for (unsigned retry = 0; retry < 8; retry++) {
+    auto delay = backoffDelay(policy, retry);
+    auto limit = std::min(policy.backoff * (1 << retry), policy.maxBackoff);
+    BOOST_CHECK(delay >= limit / 2 && delay <= limit);
+  }
+
+  auto transient = [](const std::exception& error) { return dynamic_cast<const std::range_error*>(&error) != nullptr; };
+  std::vector<unsigned> attempts;
+  auto result = retry<int>(policy, [&](unsigned attempt) {
+    attempts.push_back(attempt);
+    if (attempt < 2) {
+      throw std::range_error("transient");
+    }
+    return 42;
+  }, transient);
+  BOOST_CHECK_EQUAL(result, 42);
+  BOOST_CHECK_EQUAL(attempts.size(), 3);
+
+  // Other errors and the last transient one are thrown
+  int calls = 0;
+  BOOST_CHECK_THROW(retry<int>(policy, [&](unsigned) -> int { calls++; throw std::logic_error("fatal"); }, transient),
+                    std::logic_error);
+  BOOST_CHECK_EQUAL(calls, 1);
+  BOOST_CHECK_THROW(retry<int>(policy, [&](unsigned) -> int { calls++; throw std::range_error("transient"); }, transient),
+                    std::range_error);
+  BOOST_CHECK_EQUAL(calls, 5);
+}
+
+BOOST_AUTO_TEST_CASE(LatencyPercentile)
+{
+  using namespace o2::configuration::backends;
+  LatencyWindow window;
+  for (int i = 1; i < 16; i++) {
+    window.record(std::chrono::milliseconds(i));
+  }
+  BOOST_CHECK(!window.percentile(95));
+  for (int i = 16; i <= 100; i++) {
+    window.record(std::chrono::milliseconds(i));
+  }
+  BOOST_CHECK(*window.percentile(95) == std::chrono::milliseconds(96));
+  BOOST_CHECK(*window.percentile(100) == std::chrono::milliseconds(100));
+}
+
+BOOST_AUTO_TEST_CASE(StaleWhileRevalidate)
+{
+  using o2::configuration::backends::StaleCache;
+  StaleCache<std::string> cache;
+  cache.setTtl(std::chrono::milliseconds(20), std::chrono::milliseconds(0));
+  std::atomic<int> fetches{ 0 };
+  std::atomic<bool> reachable{ true };
+  auto fetch = [&]() {
+    if (!reachable) {
+      throw std::runtime_error("unreachable");
+    }
+    return std::to_string(++fetches);
+  };
+
+  BOOST_CHECK_EQUAL(cache.get("key", fetch), "1");
+  BOOST_CHECK_EQUAL(cache.get("key", fetch), "1");
+  BOOST_CHECK_EQUAL(fetches, 1);
+
+  // Past the soft TTL the cached value is returned and refreshed in the background
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  BOOST_CHECK_EQUAL(cache.get("key", fetch), "1");
+  while (fetches < 2) {
+    std::this_thread::yield();
+  }
+  while (cache.get("key", fetch) != "2") {
+    std::this_thread::yield();
+  }
+
+  // Failed refreshes keep the stale value and raise the health flag
+  reachable = false;
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  cache.get("key", fetch);
+  while (cache.isHealthy()) {
+    std::this_thread::yield();
+  }
+  BOOST_CHECK_EQUAL(cache.get("key", fetch), "2");
+  BOOST_CHECK_THROW(cache.get("other", fetch), std::runtime_error);
+  reachable = true;
+  BOOST_CHECK_EQUAL(cache.get("other", fetch), "3");
+  BOOST_CHECK(cache.isHealthy());
+}
+
+BOOST_AUTO_TEST_CASE(StaleHardTtl)
+{
+  using o2::configuration::backends::StaleCache;
+  StaleCache<std::string> cache;
+  cache.setTtl(std::chrono::milliseconds(5), std::chrono::milliseconds(20));
+  int fetches = 0;
+  BOOST_CHECK_EQUAL(cache.get("key", [&] { return std::to_string(++fetches); }), "1");
+
+  // Past the hard TTL the value is fetched before returning, or served stale when that fails
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  BOOST_CHECK_EQUAL(cache.get("key", [&]() -> std::string { throw std::runtime_error("unreachable"); }), "1");
+  BOOST_CHECK(!cache.isHealthy());
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  BOOST_CHECK_EQUAL(cache.get("key", [&] { return std::to_string(++fetches); }), "2");
+  BOOST_CHECK(cache.isHealthy());
+}
+
+BOOST_AUTO_TEST_CASE(StaleInvalidateDuringRefresh)
+{
+  using o2::configuration::backends::StaleCache;
+  StaleCache<std::string> cache;
+  cache.setTtl(std::chrono::milliseconds(5), std::chrono::milliseconds(0));
+  BOOST_CHECK_EQUAL(cache.get("key", [] { return std::string("before"); }), "before");
+
+  // A write lands while the background refresh is reading the value from before it
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::promise<void> started;
+  std::promise<void> written;
+  auto writtenFuture = written.get_future().share();
+  cache.get("key", [&] {
+    started.set_value();
+    writtenFuture.wait();
+    return std::string("before");
+  });
+  started.get_future().wait();
+  cache.invalidate("key");
+  written.set_value();
+
+  // The result of the refresh is dropped, the value is fetched again
+  BOOST_CHECK_EQUAL(cache.get("key", [] { return std::string("after"); }), "after");
+  BOOST_CHECK_EQUAL(cache.get("key", [] { return std::string("later"); }), "after");
+}
+
+BOOST_AUTO_TEST_CASE(StaleCacheFootprint)
+{
+  using o2::configuration::backends::StaleCache;
+  StaleCache<std::string> cache;
+  cache.setTtl(std::chrono::seconds(10), std::chrono::seconds(0));
+  BOOST_CHECK_EQUAL(cache.getFootprint(), 0);
+  const std::string value(1000, 'x');
+  cache.get("key", [&] { return value; });
+  BOOST_CHECK_GT(cache.getFootprint(), value.size());
+  cache.invalidate("key");
+  BOOST_CHECK_LT(cache.getFootprint(), value.size());
+}
+
+BOOST_AUTO_TEST_CASE(SingleFlightCoalesces)
+{
+  using o2::configuration::backends::SingleFlight;
+  SingleFlight<std::string> flight;
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::atomic<int> fetches{ 0 };
+  auto fetch = [&]() {
+    fetches++;
+    released.wait();
+    return std::string("value");
+  };
+
+  // The first caller blocks in fetch, the others arrive while its request is in flight
+  std::vector<std::future<std::string>> results;
+  results.push_back(std::async(std::launch::async, [&] { return flight.run("key", fetch); }));
+  while (fetches == 0) {
+    std::this_thread::yield();
+  }
+  for (int i = 0; i < 7; i++) {
+    results.push_back(std::async(std::launch::async, [&] { return flight.run("key", fetch); }));
+  }
+  while (flight.getStatistics().coalesced < 7) {
+    std::this_thread::yield();
+  }
+  release.set_value();
+  for (auto& result : results) {
+    BOOST_CHECK_EQUAL(result.get(), "value");
+  }
+  BOOST_CHECK_EQUAL(fetches, 1);
+  BOOST_CHECK_EQUAL(flight.getStatistics().requests, 1);
+  BOOST_CHECK_EQUAL(flight.getStatistics().coalesced, 7);
+
+  // Finished requests are not cached
+  BOOST_CHECK_EQUAL(flight.run("key", fetch), "value");
+  BOOST_CHECK_EQUAL(fetches, 2);
+}
+
+BOOST_AUTO_TEST_CASE(SingleFlightPropagatesErrors)
+{
+  using o2::configuration::backends::SingleFlight;
+  SingleFlight<std::string> flight;
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::atomic<int> fetches{ 0 };
+  auto fetch = [&]() -> std::string {
+    fetches++;
+    released.wait();
+    throw std::runtime_error("unreachable");
+  };
+
+  auto first = std::async(std::launch::async, [&] { return flight.run("key", fetch); });
+  while (fetches == 0) {
+    std::this_thread::yield();
+  }
+  auto second = std::async(std::launch::async, [&] { return flight.run("key", fetch); });
+  while (flight.getStatistics().coalesced < 1) {
+    std::this_thread::yield();
+  }
+  release.set_value();
+  BOOST_CHECK_THROW(first.get(), std::runtime_error);
+  BOOST_CHECK_THROW(second.get(), std::runtime_error);
+  BOOST_CHECK_EQUAL(fetches, 1);
+}
+
 } // Anonymous namespace
@@ -6,9 +6,12 @@
 
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <unordered_map>
 #include "Configuration/ConfigurationFactory.h"
 #include "Configuration/ConfigurationInterface.h"
+#include "../src/Backends/Consul/ConsulBlobBackend.h"
+#include "../src/CommandLineUtilities/Sync.h"
 
 #define BOOST_TEST_MODULE ConsulBackend
 #define BOOST_TEST_MAIN
@@ -73,6 +76,198 @@ BOOST_AUTO_TEST_CASE(ConsulMap)
   BOOST_CHECK_EQUAL(leaf["three"], "3");
 }
 
+BOOST_AUTO_TEST_CASE(ConsulPutRecursive)
+{
+  auto conf = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
+  boost::property_tree::ptree tree;
+  for (int i = 0; i < 200; i++) {
+    tree.put("key" + std::to_string(i), i);
+  }
+  tree.put("nested.key", "value");
+  conf->putRecursive("configLibTest.recursive", tree);
+
+  auto map = conf->getRecursiveMap("configLibTest.recursive");
+  BOOST_CHECK_EQUAL(map.size(), 201);
+  BOOST_CHECK_EQUAL(map["key199"], "199");
+  BOOST_CHECK_EQUAL(map["nested.key"], "value");
+}
+
+BOOST_AUTO_TEST_CASE(ConsulWriteBehind)
+{
+  auto conf = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT + "?writeBehind=true");
+  conf->put<int>("configLibTest.buffered.one", 1);
+  conf->put<int>("configLibTest.buffered.two", 2);
+  BOOST_CHECK_EQUAL(conf->get<int>("configLibTest.buffered.one"), 1);
+
+  auto other = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
+  conf->flush();
+  BOOST_CHECK_EQUAL(other->get<int>("configLibTest.buffered.one"), 1);
+  BOOST_CHECK_EQUAL(other->get<int>("configLibTest.buffered.two"), 2);
+}
+
+BOOST_AUTO_TEST_CASE(ConsulRefresh)
+{
+  auto conf = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
+  auto writer = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
+  auto consul = dynamic_cast<backends::ConsulBackend*>(conf.get());
+  consul->keepPrefix("configLibTest.refresh");
+  writer->put<int>("configLibTest.refresh.one", 1);
+  writer->put<int>("configLibTest.refresh.two", 2);
+  BOOST_CHECK_EQUAL(conf->getRecursive("configLibTest.refresh").get<int>("one"), 1);
+  BOOST_CHECK_EQUAL(conf->getRecursiveMap("configLibTest.refresh")["two"], "2");
+
+  // Kept values are read from Consul again only by refresh, or after writes of the same instance
+  writer->put<int>("configLibTest.refresh.one", 11);
+  writer->erase("configLibTest.refresh.two");
+  BOOST_CHECK_EQUAL(conf->getRecursive("configLibTest.refresh").get<int>("one"), 1);
+  conf->refresh();
+  auto tree = conf->getRecursive("configLibTest.refresh");
+  BOOST_CHECK_EQUAL(tree.get<int>("one"), 11);
+  BOOST_CHECK(!tree.get_optional<int>("two"));
+  BOOST_CHECK_EQUAL(conf->getRecursiveMap("configLibTest.refresh").count("two"), 0);
+  conf->put<int>("configLibTest.refresh.three", 3);
+  BOOST_CHECK_EQUAL(conf->getRecursive("configLibTest.refresh").get<int>("three"), 3);
+
+  // Dropped prefixes are read at each call
+  consul->dropPrefix("configLibTest.refresh");
+  writer->put<int>("configLibTest.refresh.one", 1);
+  BOOST_CHECK_EQUAL(conf->getRecursive("configLibTest.refresh").get<int>("one"), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ConsulPrefetch)
+{
+  auto conf = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT,
+    {"configLibTest.tree", "configLibTest.my_string"}, std::chrono::milliseconds(1000));
+  BOOST_CHECK_EQUAL(conf->get<int>("configLibTest.tree.one"), 1);
+  BOOST_CHECK_EQUAL(conf->get<std::string>("configLibTest.my_string"), "configuration");
+  BOOST_CHECK_EQUAL(conf->get<int>("configLibTest.tree.missing", -1), -1);
+
+  // Keys merely starting with a prefetched key are not under it
+  auto writer = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
+  writer->put<std::string>("configLibTest.my_string_other", "other");
+  BOOST_CHECK_EQUAL(conf->get<std::string>("configLibTest.my_string_other"), "other");
+
+  // Prefetched values are read again after refresh
+  writer->put<int>("configLibTest.tree.one", 11);
+  conf->refresh();
+  BOOST_CHECK_EQUAL(conf->get<int>("configLibTest.tree.one"), 11);
+  writer->put<int>("configLibTest.tree.one", 1);
+}
+
+BOOST_AUTO_TEST_CASE(ConsulKeyFilter)
+{
+  auto conf = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT + "?keyFilter=true");
+  auto writer = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
+  writer->put<int>("configLibTest.filter.one", 1);
+  writer->erase("configLibTest.filter.two");
+  BOOST_CHECK_EQUAL(conf->get<int>("configLibTest.filter.one"), 1);
+  BOOST_CHECK_EQUAL(conf->get<int>("configLibTest.filter.two", -1), -1);
+
+  // Keys created elsewhere are known after refresh, keys written by the instance immediately
+  writer->put<int>("configLibTest.filter.two", 2);
+  BOOST_CHECK_EQUAL(conf->get<int>("configLibTest.filter.two", -1), -1);
+  conf->refresh();
+  BOOST_CHECK_EQUAL(conf->get<int>("configLibTest.filter.two"), 2);
+  conf->put<int>("configLibTest.filter.three", 3);
+  BOOST_CHECK_EQUAL(conf->get<int>("configLibTest.filter.three"), 3);
+}
+
+BOOST_AUTO_TEST_CASE(ConsulMatching)
+{
+  auto conf = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
+  conf->put<int>("configLibTest.matching.a.port", 1);
+  conf->put<int>("configLibTest.matching.b.port", 2);
+  conf->put<int>("configLibTest.matching.b.nested.port", 3);
+  auto ports = conf->getMatching("configLibTest.matching.*.port");
+  BOOST_CHECK_EQUAL(ports.size(), 2);
+  BOOST_CHECK_EQUAL(ports["configLibTest.matching.b.port"], "2");
+  BOOST_CHECK_EQUAL(conf->getMatching("configLibTest.matching.**.port").size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(ConsulListKeys)
+{
+  auto conf = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
+  conf->put<int>("configLibTest.list.a.port", 1);
+  conf->put<int>("configLibTest.list.b", 2);
+  conf->put<int>("configLibTest.list.c", 3);
+  conf->put<int>("configLibTest.list.c.port", 4);
+  BOOST_CHECK(conf->listKeys("configLibTest.list") == std::vector<std::string>({ "a", "b", "c" }));
+  BOOST_CHECK(conf->listKeys("configLibTest.list", true) == std::vector<std::string>({ "a.port", "b", "c.port" }));
+
+  // Leaves of the tree, like the default implementation
+  BOOST_CHECK(conf->listKeys("configLibTest.list", true) == conf->ConfigurationInterface::listKeys("configLibTest.list", true));
+  BOOST_CHECK(conf->listKeys("configLibTest.missing").empty());
+}
+
+BOOST_AUTO_TEST_CASE(ConsulPages)
+{
+  auto conf = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT + "?pageSize=2");
+  for (int i = 0; i < 5; i++) {
+    conf->put<int>("configLibTest.pages.small.key" + std::to_string(i), i);
+    conf->put<int>("configLibTest.pages.large.folder" + std::to_string(i) + ".key", i);
+  }
+  auto map = conf->getRecursiveMap("configLibTest.pages");
+  BOOST_CHECK_EQUAL(map.size(), 10);
+  BOOST_CHECK_EQUAL(map["large.folder3.key"], "3");
+  BOOST_CHECK_EQUAL(conf->getRecursive("configLibTest.pages").get<int>("small.key4"), 4);
+
+  auto consul = dynamic_cast<backends::ConsulBackend*>(conf.get());
+  std::size_t values = 0;
+  consul->getRecursivePages("configLibTest.pages", [&](KeyValueMap& page) {
+    BOOST_CHECK_LE(page.size(), 2);
+    values += page.size();
+  });
+  BOOST_CHECK_EQUAL(values, 10);
+}
+
+BOOST_AUTO_TEST_CASE(ConsulPagesAborted)
+{
+  auto conf = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT + "?pageSize=2");
+  auto writer = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
+  for (int i = 0; i < 4; i++) {
+    writer->put<int>("configLibTest.aborted.key" + std::to_string(i), i);
+  }
+
+  // A key removed after the listing aborts the transaction of its page, which is then read key by key
+  auto consul = dynamic_cast<backends::ConsulBackend*>(conf.get());
+  std::vector<std::size_t> pages;
+  consul->getRecursivePages("configLibTest.aborted", [&](KeyValueMap& page) {
+    if (pages.empty()) {
+      writer->erase("configLibTest.aborted.key3");
+    }
+    pages.push_back(page.size());
+  });
+  BOOST_CHECK(pages == std::vector<std::size_t>({ 2, 1 }));
+}
+
+BOOST_AUTO_TEST_CASE(ConsulSyncPrefixed)
+{
+  auto root = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
+  auto destination = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT + "/configLibTest/sync");
+  root->put<int>("stale", 1);
+  destination->put<int>("stale", 2);
+
+  boost::property_tree::ptree values;
+  values.put("kept", 3);
+  auto& array = values.put_child("array", {});
+  array.push_back({ "", boost::property_tree::ptree("") });
+  array.push_back({ "", boost::property_tree::ptree("x") });
+  std::ostringstream log;
+  auto statistics = sync::sync(values, *destination, false, log);
+  BOOST_CHECK_EQUAL(statistics.removed, 1);
+
+  // Keys outside of the base path are left untouched
+  BOOST_CHECK_EQUAL(root->get<int>("stale"), 1);
+  BOOST_CHECK_EQUAL(destination->get<int>("stale", -1), -1);
+  BOOST_CHECK_EQUAL(destination->get<std::string>("array.1"), "x");
+
+  // Nothing left to write once in sync
+  statistics = sync::sync(values, *destination, false, log);
+  BOOST_CHECK_EQUAL(statistics.added + statistics.changed + statistics.removed, 0);
+  BOOST_CHECK_EQUAL(statistics.unchanged, 3);
+  root->erase("stale");
+}
+
 BOOST_AUTO_TEST_CASE(ConsulPtree)
 {
   auto conf = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
@@ -138,6 +333,24 @@ BOOST_AUTO_TEST_CASE(ConsulJson)
  
 }
   
+BOOST_AUTO_TEST_CASE(ConsulJsonReload)
+{
+  auto writer = ConfigurationFactory::getConfiguration("consul://" + CONSUL_ENDPOINT);
+  writer->put<std::string>("configLibTest.reload.json", R"({"version": 1})");
+  auto conf = ConfigurationFactory::getConfiguration("consul-json://" + CONSUL_ENDPOINT + "/configLibTest.reload.json");
+  auto other = ConfigurationFactory::getConfiguration("consul-json://" + CONSUL_ENDPOINT + "/configLibTest.reload.json");
+  BOOST_CHECK_EQUAL(other->get<int>("version"), 1);
+
+  auto blob = dynamic_cast<o2::configuration::backends::ConsulBlobBackend*>(conf.get());
+  BOOST_REQUIRE(blob != nullptr);
+  BOOST_CHECK(!blob->reload());
+  writer->put<std::string>("configLibTest.reload.json", R"({"version": 2})");
+  BOOST_CHECK(blob->reload());
+  BOOST_CHECK_EQUAL(conf->get<int>("version"), 2);
+  other->refresh();
+  BOOST_CHECK_EQUAL(other->get<int>("version"), 2);
+}
+
 BOOST_AUTO_TEST_CASE(ConsulJsonInvalid)
 {
   BOOST_CHECK_THROW(ConfigurationFactory::getConfiguration("consul-json://" + CONSUL_ENDPOINT + "/invalid.json"), std::runtime_error);
@@ -0,0 +1,58 @@
+/// \file TestDirectory.cxx
+/// \brief Directory backend unit tests.
+///
+
+#include <filesystem>
+#include <fstream>
+#include "Configuration/ConfigurationFactory.h"
+
+#define BOOST_TEST_MODULE DirectoryBackend
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace o2::configuration;
+
+namespace
+{
+
+const std::string TEMP_DIR = "/tmp/alice_o2_configuration_test_dir";
+
+BOOST_AUTO_TEST_CASE(DirectoryFiles)
+{
+  namespace fs = std::filesystem;
+  fs::remove_all(TEMP_DIR);
+  fs::create_directories(TEMP_DIR + "/qc/tasks");
+  std::ofstream(TEMP_DIR + "/qc.json") << R"({"config": {"database": "ccdb"}})";
+  std::ofstream(TEMP_DIR + "/qc/tasks/tpc.json") << R"({"moduleName": "QcTPC", "active": true})";
+  std::ofstream(TEMP_DIR + "/qc/tasks/its.ini") << "[task]\nmoduleName=QcITS\n";
+  std::ofstream(TEMP_DIR + "/readout.ini") << "[equipment-1]\nenabled=1\n";
+  std::ofstream(TEMP_DIR + "/notes.txt") << "not a configuration";
+
+  auto conf = ConfigurationFactory::getConfiguration("dir:/" + TEMP_DIR);
+  BOOST_CHECK_EQUAL(conf->get<std::string>("qc.config.database"), "ccdb");
+  BOOST_CHECK_EQUAL(conf->get<std::string>("qc.tasks.tpc.moduleName"), "QcTPC");
+  BOOST_CHECK_EQUAL(conf->get<bool>("qc.tasks.tpc.active"), true);
+  BOOST_CHECK_EQUAL(conf->get<std::string>("qc.tasks.its.task.moduleName"), "QcITS");
+  BOOST_CHECK_EQUAL(conf->get<int>("readout.equipment-1.enabled"), 1);
+  BOOST_CHECK(!conf->getString("notes"));
+
+  auto tasks = conf->getRecursiveMap("qc.tasks");
+  BOOST_CHECK_EQUAL(tasks["tpc.moduleName"], "QcTPC");
+  BOOST_CHECK_EQUAL(tasks["its.task.moduleName"], "QcITS");
+}
+
+BOOST_AUTO_TEST_CASE(DirectoryErrors)
+{
+  // Files of the same prefix would replace each other's values
+  std::ofstream(TEMP_DIR + "/qc.ini") << "[config]\ndatabase=other\n";
+  BOOST_CHECK_THROW(ConfigurationFactory::getConfiguration("dir:/" + TEMP_DIR), std::runtime_error);
+  std::filesystem::remove(TEMP_DIR + "/qc.ini");
+
+  std::ofstream(TEMP_DIR + "/broken.json") << R"({"moduleName": )";
+  BOOST_CHECK_THROW(ConfigurationFactory::getConfiguration("dir:/" + TEMP_DIR), std::runtime_error);
+  BOOST_CHECK_THROW(ConfigurationFactory::getConfiguration("dir:/" + TEMP_DIR + "/qc.json"), std::runtime_error);
+  std::filesystem::remove_all(TEMP_DIR);
+}
+
+} // Anonymous namespace
@@ -10,6 +10,8 @@
 #include "Configuration/ConfigurationFactory.h"
 #include "Configuration/ConfigurationInterface.h"
 #include "../src/Backends/Ini/IniBackend.h"
+#include "../src/Backends/Ini/IniParser.h"
+#include <boost/property_tree/ini_parser.hpp>
 
 #define BOOST_TEST_MODULE IniBackend
 #define BOOST_TEST_MAIN
@@ -106,4 +108,53 @@ BOOST_AUTO_TEST_CASE(IniFileUseStream)
   BOOST_CHECK(conf->get<int>("section.key_int") == 123);
 }
 
+BOOST_AUTO_TEST_CASE(IniParserMatchesBoost)
+{
+  using boost::property_tree::ini_parser::ini_parser_error;
+  const std::vector<std::string> inputs = {
+    "", "key=value", "; comment\n# comment\n\n  key = two words \r\n[ section ]\n key2 =\n[empty]\n",
+    "[section]\n[section]\n", "[section]\nkey=1\n[section]\n", "key=1\n[key]\n",
+    "[section\n", "key\n", "=value\n", "key=1\nkey=2\n", "a=b=c\n[s]x\ny=z"
+  };
+  for (const auto& input : inputs) {
+    boost::property_tree::ptree expected, tree;
+    std::string expectedError, error;
+    try {
+      std::istringstream ss(input);
+      boost::property_tree::ini_parser::read_ini(ss, expected);
+    } catch (const ini_parser_error& e) {
+      expectedError = e.what();
+    }
+    try {
+      backends::readIni(input.data(), input.size(), tree);
+    } catch (const ini_parser_error& e) {
+      error = e.what();
+    }
+    BOOST_CHECK_EQUAL(error, expectedError);
+    BOOST_CHECK(tree == expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(IniGzip)
+{
+  const std::string compressed("\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03\x8b\x2e\x4e\x4d\x2e\xc9\xcc\xcf\x8b\xe5"
+    "\xca\x4e\xad\xb4\x2d\x4b\xcc\x29\x4d\xe5\x02\x00\xb9\x9b\x97\xa6\x14\x00\x00\x00", 40);
+  backends::IniBackend backend(compressed, true);
+  BOOST_CHECK_EQUAL(backend.get<std::string>("section.key"), "value");
+}
+
+BOOST_AUTO_TEST_CASE(IniFileErrors)
+{
+  {
+    std::ofstream stream(TEMP_FILE);
+    stream << "key=value\n[section\n";
+  }
+  try {
+    ConfigurationFactory::getConfiguration("ini:/" + TEMP_FILE);
+    BOOST_FAIL("Ill-formed file accepted");
+  } catch (const std::runtime_error& e) {
+    BOOST_CHECK_EQUAL(e.what(), "unmatched '[' in " + TEMP_FILE + " line 2");
+  }
+}
+
 } // Anonymous namespace
@@ -4,12 +4,21 @@
 /// \author Adam Wegrzynek, CERN
 ///
 
+#include <array>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <memory_resource>
 #include <unordered_map>
 #include "Configuration/ConfigurationFactory.h"
 #include "Configuration/ConfigurationInterface.h"
 #include "../src/Backends/Json/JsonBackend.h"
+#include "../src/Backends/Json/JsonFlattener.h"
+#include "../src/Backends/Json/JsonParallelParser.h"
+#include "../src/Backends/CountingResource.h"
+#include "../src/Backends/InternedTree.h"
+#include "../src/CommandLineUtilities/Sync.h"
+#include <boost/property_tree/json_parser.hpp>
 
 #define BOOST_TEST_MODULE JsonBackend
 #define BOOST_TEST_MAIN
@@ -35,6 +44,7 @@ BOOST_AUTO_TEST_CASE(JsonFileTest)
         "un",
         "deux"
       ],
+      "thresholds": [1.5, -2, 3e2, 0.125],
       "complex_array": [
         {"host": "127.0.0.1", "port": 123},
         {"host": "192.168.1.1", "port": 123},
@@ -89,6 +99,180 @@ BOOST_AUTO_TEST_CASE(JsonFileRecursiveMapTest)
   BOOST_CHECK_EQUAL(leaf["onclick"], "CreateNewDoc");
 }
 
+BOOST_AUTO_TEST_CASE(JsonFileRecursiveMapShared)
+{
+  auto conf = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE);
+  auto map = conf->getRecursiveMapShared("configuration_library");
+  BOOST_CHECK_EQUAL(map->at("id"), "file");
+  BOOST_CHECK_EQUAL(map->at("popup.menuitem.one.value"), "123");
+  BOOST_CHECK(*map == conf->getRecursiveMap("configuration_library"));
+
+  // Repeated calls share the same map
+  BOOST_CHECK_EQUAL(map, conf->getRecursiveMapShared("configuration_library"));
+  BOOST_CHECK_NE(map, conf->getRecursiveMapShared("configuration_library.popup"));
+
+  // Same path with a prefix set
+  conf->setPrefix("configuration_library");
+  BOOST_CHECK_EQUAL(map, conf->getRecursiveMapShared(""));
+}
+
+BOOST_AUTO_TEST_CASE(JsonInternedTree)
+{
+  boost::property_tree::ptree tree;
+  std::istringstream ss(R"({"tasks": {
+    "a": {"moduleName": "QcSkeleton", "detectorName": "TST", "list": [1, 2]},
+    "b": {"moduleName": "QcSkeleton", "detectorName": "TPC", "list": [3, 1]}
+  }})");
+  boost::property_tree::read_json(ss, tree);
+  backends::InternedTree interned(tree, std::pmr::get_default_resource());
+
+  // Same content and lookups as the ptree
+  BOOST_CHECK(backends::InternedTree::toPtree(*interned.find("", '.')) == tree);
+  BOOST_CHECK(backends::InternedTree::toPtree(*interned.find("tasks.a", '.')) == tree.get_child("tasks.a"));
+  BOOST_CHECK_EQUAL(*interned.find("tasks/b/detectorName", '/')->value, "TPC");
+  BOOST_CHECK_EQUAL(interned.find("tasks.c", '.'), nullptr);
+  BOOST_CHECK_EQUAL(interned.find("tasks.a.moduleName.x", '.'), nullptr);
+
+  // Equal values share storage
+  BOOST_CHECK_EQUAL(interned.find("tasks.a.moduleName", '.')->value, interned.find("tasks.b.moduleName", '.')->value);
+  BOOST_CHECK_EQUAL(interned.find("tasks.a.list", '.')->children[0].second.value,
+                    interned.find("tasks.b.list", '.')->children[1].second.value);
+
+  const auto& stats = interned.getStatistics();
+  BOOST_CHECK_LT(stats.strings, stats.references);
+  BOOST_CHECK_LT(stats.pooledBytes, stats.referencedBytes);
+
+  // Wide nodes are searched through their index, the first of repeated names is found as in a ptree
+  boost::property_tree::ptree wide;
+  for (int i = 100; i > 0; i--) {
+    wide.add("section.key" + std::to_string(i % 60), i);
+  }
+  backends::InternedTree internedWide(wide, std::pmr::get_default_resource());
+  for (int i = 0; i < 60; i++) {
+    auto key = "section.key" + std::to_string(i);
+    BOOST_CHECK_EQUAL(std::string(*internedWide.find(key, '.')->value), wide.get<std::string>(key));
+  }
+  BOOST_CHECK_EQUAL(internedWide.find("section.tasks", '.'), nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(JsonFileMemoryResource)
+{
+  backends::CountingResource resource;
+  {
+    auto conf = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE, &resource);
+    BOOST_CHECK_EQUAL(conf->get<std::string>("configuration_library.id"), "file");
+    BOOST_CHECK_GT(resource.getAllocated(), 0);
+  }
+  BOOST_CHECK_GT(resource.getPeak(), 0);
+  BOOST_CHECK_EQUAL(resource.getAllocated(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(JsonFileMemoryUsage)
+{
+  backends::CountingResource resource;
+  auto conf = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE, &resource);
+  auto usage = conf->memoryUsage();
+  BOOST_CHECK_GT(usage.keys, 0);
+  BOOST_CHECK_GT(usage.values, 0);
+  BOOST_CHECK_EQUAL(usage.caches, 0);
+
+  // All memory held from the resource is reported, besides the tree object itself
+  BOOST_CHECK_EQUAL(usage.keys + usage.values + usage.structure,
+                    resource.getAllocated() + sizeof(backends::InternedTree));
+
+  conf->getRecursiveMapShared("configuration_library");
+  BOOST_CHECK_GT(conf->memoryUsage().caches, 0);
+  BOOST_CHECK_EQUAL(conf->memoryUsage().keys, usage.keys);
+}
+
+BOOST_AUTO_TEST_CASE(JsonFileStartupProfile)
+{
+  auto names = [](const std::vector<Phase>& phases) {
+    std::vector<std::string> names;
+    for (const auto& phase : phases) {
+      names.push_back(phase.name);
+    }
+    return names;
+  };
+  auto conf = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE);
+  BOOST_CHECK(names(conf->getStartupProfile()) == std::vector<std::string>({ "uri", "files", "transfer", "parse", "index" }));
+
+  // Only the first lookup is measured
+  conf->get<std::string>("configuration_library.id");
+  auto profile = conf->getStartupProfile();
+  BOOST_CHECK_EQUAL(profile.back().name, "lookup");
+  conf->get<std::string>("configuration_library.id");
+  BOOST_CHECK(conf->getStartupProfile().back().duration == profile.back().duration);
+
+  auto prefetched = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE, { "configuration_library" },
+                                                           std::chrono::milliseconds(100));
+  BOOST_CHECK_EQUAL(prefetched->getStartupProfile().back().name, "prefetch");
+}
+
+BOOST_AUTO_TEST_CASE(JsonFileMatching)
+{
+  auto conf = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE);
+  auto one = conf->getMatching("configuration_library.popup.*.one.value");
+  BOOST_CHECK_EQUAL(one.size(), 1);
+  BOOST_CHECK_EQUAL(one["configuration_library.popup.menuitem.one.value"], "123");
+
+  auto values = conf->getMatching("**.value");
+  BOOST_CHECK_EQUAL(values.size(), 1);
+  BOOST_CHECK_EQUAL(values.count("configuration_library.popup.menuitem.one.value"), 1);
+
+  auto popup = conf->getMatching("configuration_library.popup.**");
+  BOOST_CHECK_EQUAL(popup["configuration_library.popup.menuitem.one.onclick"], "CreateNewDoc");
+  BOOST_CHECK_EQUAL(popup.count("configuration_library.id"), 0);
+
+  BOOST_CHECK(conf->getMatching("configuration_library.*.missing").empty());
+  BOOST_CHECK(conf->getMatching("missing.**").empty());
+
+  // The tree walk gives the same values as filtering the whole map
+  for (const auto& pattern : { "configuration_library.*", "**.one.*", "**", "configuration_library.**.onclick" }) {
+    BOOST_CHECK(conf->getMatching(pattern) == conf->ConfigurationInterface::getMatching(pattern));
+  }
+
+  // Paths are relative to the prefix
+  conf->setPrefix("configuration_library");
+  auto prefixed = conf->getMatching("popup.*.one.value");
+  BOOST_CHECK_EQUAL(prefixed["popup.menuitem.one.value"], "123");
+  BOOST_CHECK(prefixed == conf->ConfigurationInterface::getMatching("popup.*.one.value"));
+}
+
+BOOST_AUTO_TEST_CASE(JsonFileListKeys)
+{
+  auto conf = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE);
+  auto keys = conf->listKeys("configuration_library.popup.menuitem.one");
+  BOOST_CHECK(keys == std::vector<std::string>({ "onclick", "value" }));
+  auto all = conf->listKeys("configuration_library.popup", true);
+  BOOST_CHECK(all == std::vector<std::string>({ "menuitem.one.onclick", "menuitem.one.value" }));
+  BOOST_CHECK(conf->listKeys("configuration_library.missing").empty());
+
+  // Same names as the default implementation, which gets the values too
+  for (const auto& path : { "", "configuration_library", "configuration_library.complex_array" }) {
+    BOOST_CHECK(conf->listKeys(path) == conf->ConfigurationInterface::listKeys(path));
+    BOOST_CHECK(conf->listKeys(path, true) == conf->ConfigurationInterface::listKeys(path, true));
+  }
+
+  conf->setPrefix("configuration_library.popup");
+  BOOST_CHECK(conf->listKeys("") == std::vector<std::string>({ "menuitem" }));
+}
+
+BOOST_AUTO_TEST_CASE(JsonFileGzip)
+{
+  const std::string file = "/tmp/alice_o2_configuration_test_file.json.gz";
+  const std::string compressed("\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03\xab\x56\x4a\xce\xcf\x2d\x28\x4a\x2d\x2e\x4e\x4d"
+    "\x51\xb2\x52\xa8\x56\xca\x4e\xad\x04\xd2\x4a\x65\x89\x39\xa5\xa9\x4a\xb5\xb5\x00\x8f\x07\x69\x07\x20\x00\x00\x00", 50);
+  std::ofstream(file, std::ios::binary) << compressed;
+  auto conf = ConfigurationFactory::getConfiguration("json:/" + file);
+  BOOST_CHECK_EQUAL(conf->get<std::string>("compressed.key"), "value");
+
+  // Truncated data
+  std::ofstream(file, std::ios::binary) << compressed.substr(0, 30);
+  BOOST_CHECK_THROW(ConfigurationFactory::getConfiguration("json:/" + file), std::runtime_error);
+  std::remove(file.c_str());
+}
+
 BOOST_AUTO_TEST_CASE(JsonFilePrefix)
 {
   auto conf = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE);
@@ -102,6 +286,12 @@ BOOST_AUTO_TEST_CASE(JsonFilePrefix)
   BOOST_CHECK_EQUAL(conf->get<int>("value"), 123);
 }
 
+BOOST_AUTO_TEST_CASE(JsonFilePrefetch)
+{
+  auto conf = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE, {"configuration_library"}, std::chrono::milliseconds(100));
+  BOOST_CHECK_EQUAL(conf->get<std::string>("configuration_library.id"), "file");
+}
+
 BOOST_AUTO_TEST_CASE(JsonFileArray)
 {
   auto conf = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE);
@@ -116,6 +306,26 @@ BOOST_AUTO_TEST_CASE(JsonFileArray)
   BOOST_CHECK_EQUAL(merged, "zeroundeux");
 }
 
+BOOST_AUTO_TEST_CASE(JsonFileNumericArray)
+{
+  auto conf = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE);
+  auto thresholds = conf->getArray<double>("configuration_library.thresholds");
+  BOOST_CHECK_EQUAL(thresholds.size(), 4);
+  BOOST_CHECK_EQUAL(thresholds[0], 1.5);
+  BOOST_CHECK_EQUAL(thresholds[1], -2.0);
+  BOOST_CHECK_EQUAL(thresholds[2], 300.0);
+  BOOST_CHECK_EQUAL(thresholds[3], 0.125);
+
+  BOOST_CHECK_THROW(conf->getArray<int>("configuration_library.thresholds"), std::runtime_error);
+  BOOST_CHECK_THROW(conf->getArray<double>("configuration_library.array"), std::runtime_error);
+
+  // Same elements written into memory of the caller, which must have room for all of them
+  std::array<float, 5> buffer{};
+  BOOST_CHECK_EQUAL(conf->getArray<float>("configuration_library.thresholds", buffer.data(), buffer.size()), 4);
+  BOOST_CHECK_EQUAL(buffer[2], 300.0f);
+  BOOST_CHECK_THROW(conf->getArray<float>("configuration_library.thresholds", buffer.data(), 3), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(JsonFileNestedArray)
 {
   auto conf = ConfigurationFactory::getConfiguration("json:/" + TEMP_FILE);
@@ -158,4 +368,115 @@ BOOST_AUTO_TEST_CASE(JsonStream)
   BOOST_CHECK_EQUAL(hosts, "127.0.0.1192.168.1.1255.0.0.0");
 }
 
+BOOST_AUTO_TEST_CASE(JsonSyncFlattenArrays)
+{
+  std::istringstream ss(R"({"array": ["", "x", {"key": ""}], "empty": ""})");
+  boost::property_tree::ptree tree;
+  boost::property_tree::read_json(ss, tree);
+
+  // Empty elements keep their position, as putRecursive() stores them
+  auto map = sync::flatten(tree, false);
+  BOOST_CHECK_EQUAL(map.size(), 4);
+  BOOST_CHECK_EQUAL(map.at("array.0"), "");
+  BOOST_CHECK_EQUAL(map.at("array.1"), "x");
+  BOOST_CHECK_EQUAL(map.at("array.2.key"), "");
+  BOOST_CHECK_EQUAL(map.at("empty"), "");
+
+  // Folder keys read back from Consul are empty nodes without a name
+  boost::property_tree::ptree folders;
+  folders.put("dir.key", "value");
+  folders.get_child("dir").push_back({ "", boost::property_tree::ptree() });
+  BOOST_CHECK(sync::flatten(folders, true) == (std::map<std::string, std::string>{ { "dir.key", "value" } }));
+}
+
+BOOST_AUTO_TEST_CASE(JsonFlattenerMatchesTree)
+{
+  const std::vector<std::string> documents = {
+    R"({"a": {"b": "1", "c": [1, -2.5e3, true, null, {"d": "e"}]}, "f": "\u00e9\ud83d\ude00\n", "g": {}})",
+    R"([{"host": "127.0.0.1", "port": 123}, {"host": "192.168.1.1", "port": 123}])",
+    "123", R"("string")"
+  };
+  for (const auto& document : documents) {
+    boost::property_tree::ptree tree;
+    std::istringstream ss(document);
+    boost::property_tree::read_json(ss, tree);
+    KeyValueMap expected;
+    std::function<void(const boost::property_tree::ptree&, std::string)> parse = [&](const auto& node, std::string key) {
+      expected[key] = node.data();
+      key = key.empty() ? "" : key + '.';
+      for (auto const& it : node) {
+        parse(it.second, key + it.first);
+      }
+    };
+    parse(tree, "");
+
+    // Split the document at every position to exercise tokens spanning chunks
+    for (std::size_t split = 0; split <= document.size(); split++) {
+      KeyValueMap map;
+      backends::JsonFlattener flattener(map, '.');
+      flattener.feed(document.data(), split);
+      flattener.feed(document.data() + split, document.size() - split);
+      flattener.finish();
+      BOOST_CHECK(map == expected);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(JsonFlattenerErrors)
+{
+  for (const std::string document : {R"({"a": 1,})", R"({"a": 01})", R"({"a": 1} x)", R"({"a": tru})", R"({"a": 1)", ""}) {
+    KeyValueMap map;
+    backends::JsonFlattener flattener(map, '.');
+    BOOST_CHECK_THROW(flattener.feed(document.data(), document.size()); flattener.finish(), boost::property_tree::json_parser_error);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(JsonParallelParserMatchesSerial)
+{
+  std::string document = "{\n";
+  for (int i = 0; i < 100; i++) {
+    document += "\"task" + std::to_string(i) + "\": {\"name\": \"a, \\\"b\\\" {c} [d]\", \"list\": [1, {\"x\": null}, []], \"id\": " + std::to_string(i) + "},\n";
+  }
+  document += R"("last": "}", "same": 1, "same": 2})";
+
+  boost::property_tree::ptree expected;
+  std::istringstream ss(document);
+  boost::property_tree::read_json(ss, expected);
+  for (unsigned threads : {1, 2, 4, 16}) {
+    boost::property_tree::ptree tree;
+    backends::parseJson(document.data(), document.size(), tree, threads);
+    BOOST_CHECK(tree == expected);
+  }
+
+  // Documents which cannot be split
+  for (const std::string other : {"[1, 2]", "{}", R"({"a": 1})", "  {\"a\": 1, \"b\": 2}  "}) {
+    boost::property_tree::ptree tree, expectedTree;
+    std::istringstream otherStream(other);
+    boost::property_tree::read_json(otherStream, expectedTree);
+    backends::parseJson(other.data(), other.size(), tree, 4);
+    BOOST_CHECK(tree == expectedTree);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(JsonParallelParserErrors)
+{
+  for (const std::string document : {"{\"a\": 1,\n\"b\": 2,\n\"c\": 01}", "{\"a\": 1,\n\"b\": 2,}", "{\"a\": 1, \"b\": 2} x", "{\"a\": 1, \"b\": 2"}) {
+    std::istringstream ss(document);
+    boost::property_tree::ptree tree;
+    unsigned long line = 0;
+    try {
+      boost::property_tree::read_json(ss, tree);
+    } catch (const boost::property_tree::json_parser_error& error) {
+      line = error.line();
+    }
+    BOOST_CHECK_NE(line, 0);
+    try {
+      backends::parseJson(document.data(), document.size(), tree, 4);
+      BOOST_ERROR("No error for: " + document);
+    } catch (const boost::property_tree::json_parser_error& error) {
+      BOOST_CHECK_EQUAL(error.line(), line);
+    }
+  }
+}
+
 } // Anonymous namespace
@@ -0,0 +1,109 @@
+/// \file TestSharedMemory.cxx
+/// \brief Shared memory backend unit tests.
+///
+
+#include "Configuration/ConfigurationFactory.h"
+#include "Configuration/SharedMemoryPublisher.h"
+#include "../src/Backends/SharedMemory/SharedMemoryBackend.h"
+
+#define BOOST_TEST_MODULE SharedMemoryBackend
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace o2::configuration;
+
+namespace
+{
+
+const std::string NAME = "test-" + std::to_string(getpid());
+
+BOOST_AUTO_TEST_CASE(SharedMemoryPublish)
+{
+  BOOST_CHECK_THROW(ConfigurationFactory::getConfiguration("shm://" + NAME), std::runtime_error);
+
+  SharedMemoryPublisher publisher(NAME);
+  auto source = ConfigurationFactory::getConfiguration("str://qc.task.module=QcTPC;qc.task.cycle=10;qc.name=qc");
+  BOOST_CHECK_EQUAL(publisher.publish(*source), 1);
+
+  auto conf = ConfigurationFactory::getConfiguration("shm://" + NAME);
+  BOOST_CHECK_EQUAL(conf->get<std::string>("qc.task.module"), "QcTPC");
+  BOOST_CHECK_EQUAL(conf->get<int>("qc.task.cycle"), 10);
+  BOOST_CHECK(!conf->getString("qc.task.unknown"));
+  BOOST_CHECK(conf->getRecursive("") == source->getRecursive(""));
+  BOOST_CHECK(conf->getRecursiveMap("qc") == source->getRecursiveMap("qc"));
+  BOOST_CHECK_THROW(conf->getRecursive("qc.unknown"), boost::property_tree::ptree_error);
+
+  conf->setPrefix("qc.task");
+  BOOST_CHECK_EQUAL(conf->get<std::string>("module"), "QcTPC");
+  conf->setPrefix("");
+
+  // Strings are stored once, "qc" is counted as a key only
+  auto usage = conf->memoryUsage();
+  BOOST_CHECK_EQUAL(usage.keys, std::string("qctaskmodulecyclename").size());
+  BOOST_CHECK_EQUAL(usage.values, std::string("QcTPC10").size());
+  BOOST_CHECK_GT(usage.structure, sizeof(backends::shm::SnapshotHeader));
+
+  // Readers switch to new versions, older versions are removed
+  boost::property_tree::ptree tree;
+  for (int version = 2; version <= 4; version++) {
+    tree.put("qc.task.module", "QcITS" + std::to_string(version));
+    BOOST_CHECK_EQUAL(publisher.publish(tree), version);
+  }
+  BOOST_CHECK_EQUAL(conf->get<std::string>("qc.task.module"), "QcITS4");
+  BOOST_CHECK(!conf->getString("qc.name"));
+  BOOST_CHECK_EQUAL(dynamic_cast<backends::SharedMemoryBackend&>(*conf).getVersion(), 4);
+  BOOST_CHECK(!backends::shm::Segment::open(backends::shm::dataName(NAME, 2)));
+  BOOST_CHECK(backends::shm::Segment::open(backends::shm::dataName(NAME, 3)));
+
+  // Children are found by binary search, the first of repeated names as in a ptree
+  boost::property_tree::ptree wide;
+  for (int i = 100; i > 0; i--) {
+    wide.add("section.key" + std::to_string(i % 60), i);
+  }
+  publisher.publish(wide);
+  for (int i = 0; i < 60; i++) {
+    auto key = "section.key" + std::to_string(i);
+    BOOST_CHECK_EQUAL(conf->get<std::string>(key), wide.get<std::string>(key));
+  }
+  BOOST_CHECK(!conf->getString("section.key60"));
+  BOOST_CHECK(conf->getRecursive("") == wide);
+
+  // Arrays are parsed from the mapped values
+  boost::property_tree::ptree thresholds;
+  for (auto value : { "1.5", "-2", "300" }) {
+    thresholds.push_back({ "", boost::property_tree::ptree(value) });
+  }
+  boost::property_tree::ptree arrays;
+  arrays.add_child("qc.thresholds", thresholds);
+  publisher.publish(arrays);
+  BOOST_CHECK(conf->getArray<double>("qc.thresholds") == std::vector<double>({ 1.5, -2, 300 }));
+  double buffer[3];
+  BOOST_CHECK_EQUAL(conf->getArray<double>("qc.thresholds", buffer, 3), 3);
+  BOOST_CHECK_EQUAL(buffer[2], 300);
+}
+
+BOOST_AUTO_TEST_CASE(SharedMemoryRemoved)
+{
+  // The publisher of the previous test removed the values, but not the control segment
+  BOOST_CHECK_THROW(ConfigurationFactory::getConfiguration("shm://" + NAME), std::runtime_error);
+  BOOST_CHECK_THROW(SharedMemoryPublisher("a/b"), std::runtime_error);
+  BOOST_CHECK(backends::shm::Segment::open(backends::shm::controlName(NAME)));
+
+  // Readers of a publisher stopped cleanly pick up versions of the next one
+  auto source = ConfigurationFactory::getConfiguration("str://qc.name=first");
+  auto publisher = std::make_unique<SharedMemoryPublisher>(NAME);
+  auto version = publisher->publish(*source);
+  auto conf = ConfigurationFactory::getConfiguration("shm://" + NAME);
+  publisher.reset();
+  BOOST_CHECK_EQUAL(conf->get<std::string>("qc.name"), "first");
+  publisher = std::make_unique<SharedMemoryPublisher>(NAME);
+  BOOST_CHECK_EQUAL(publisher->publish(*ConfigurationFactory::getConfiguration("str://qc.name=second")), version + 1);
+  BOOST_CHECK_EQUAL(conf->get<std::string>("qc.name"), "second");
+
+  publisher.reset();
+  SharedMemoryPublisher::remove(NAME);
+  BOOST_CHECK(!backends::shm::Segment::open(backends::shm::controlName(NAME)));
+}
+
+} // Anonymous namespace